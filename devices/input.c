@@ -38,6 +38,15 @@ input_getc (void) {
 	return key;
 }
 
+/* Returns true if the input buffer is empty,
+   false otherwise.
+   Interrupts must be off. */
+bool
+input_empty (void) {
+	ASSERT (intr_get_level () == INTR_OFF);
+	return intq_empty (&buffer);
+}
+
 /* Returns true if the input buffer is full,
    false otherwise.
    Interrupts must be off. */
@@ -10,37 +10,67 @@
 
 /* See [8254] for hardware details of the 8254 timer chip. */
 
-#if TIMER_FREQ < 19
-#error 8254 timer requires TIMER_FREQ >= 19
-#endif
-#if TIMER_FREQ > 1000
-#error TIMER_FREQ <= 1000 recommended
-#endif
+#define PIT_HZ 1193180                  /* 8254 input frequency. */
+
+/* Number of timer interrupts per second. */
+int timer_freq = TIMER_FREQ_DEFAULT;
+
+/* PIT counts per timer tick. */
+static uint16_t pit_count;
 
 /* Number of timer ticks since OS booted. */
 static int64_t ticks;
 
+/* Tickless idle.  While only the idle thread can run, the PIT is put
+   in one-shot mode and fires once at the next callout deadline
+   instead of every tick.  ONESHOT_TICKS is the number of ticks the
+   one-shot covers, or 0 if the PIT is running periodically. */
+static int oneshot_ticks;
+static uint16_t oneshot_count;
+
 /* Number of loops per timer tick.
    Initialized by timer_calibrate(). */
 static unsigned loops_per_tick;
 
+/* Pending callouts, hashed by expiry tick into a wheel of
+   TIMER_WHEEL_SIZE slots.  Adding a callout is O(1); each tick only
+   looks at the one slot for that tick, skipping the callouts that
+   are due on a later turn of the wheel. */
+#define TIMER_WHEEL_SIZE 256
+static struct list timer_wheel[TIMER_WHEEL_SIZE];
+
+static void timer_run_callouts (void);
+static void timer_tick (void);
+static void pit_set_periodic (void);
+static int64_t timer_next_deadline (int64_t limit);
+
 static intr_handler_func timer_interrupt;
 static bool too_many_loops (unsigned loops);
 static void busy_wait (int64_t loops);
 static void real_time_sleep (int64_t num, int32_t denom);
 
+/* Sets the number of timer interrupts per second to HZ.  Must
+   be called before timer_init(). */
+void
+timer_set_freq (int hz) {
+	if (hz < TIMER_FREQ_MIN || hz > TIMER_FREQ_MAX)
+		PANIC ("timer frequency %d out of range [%d, %d]",
+				hz, TIMER_FREQ_MIN, TIMER_FREQ_MAX);
+	timer_freq = hz;
+}
+
 /* Sets up the 8254 Programmable Interval Timer (PIT) to
-   interrupt PIT_FREQ times per second, and registers the
+   interrupt TIMER_FREQ times per second, and registers the
    corresponding interrupt. */
 void
 timer_init (void) {
 	/* 8254 input frequency divided by TIMER_FREQ, rounded to
 	   nearest. */
-	uint16_t count = (1193180 + TIMER_FREQ / 2) / TIMER_FREQ;
+	pit_count = (PIT_HZ + TIMER_FREQ / 2) / TIMER_FREQ;
+	pit_set_periodic ();
 
-	outb (0x43, 0x34);    /* CW: counter 0, LSB then MSB, mode 2, binary. */
-	outb (0x40, count & 0xff);
-	outb (0x40, count >> 8);
+	for (int i = 0; i < TIMER_WHEEL_SIZE; i++)
+		list_init (&timer_wheel[i]);
 
 	intr_register_ext (0x20, timer_interrupt, "8254 Timer");
 }
@@ -126,10 +156,194 @@ void
 timer_print_stats (void) {
 	printf ("Timer: %"PRId64" ticks\n", timer_ticks ());
 }
+
+/* Initializes callout C to call FUNC with AUX. */
+void
+timer_callout_init (struct timer_callout *c, timer_callout_func *func,
+		void *aux) {
+	ASSERT (c != NULL);
+	ASSERT (func != NULL);
+
+	c->func = func;
+	c->aux = aux;
+	c->pending = false;
+}
+
+/* Arranges for C to be called from the timer interrupt at tick
+   EXPIRES, or at the next tick if EXPIRES has already passed.  C
+   must not already be pending. */
+void
+timer_callout_add (struct timer_callout *c, int64_t expires) {
+	enum intr_level old_level;
+	int64_t slot;
+
+	ASSERT (c != NULL);
+
+	old_level = intr_disable ();
+	ASSERT (!c->pending);
+	c->expires = expires;
+	c->pending = true;
+	slot = expires > ticks ? expires : ticks + 1;
+	list_push_back (&timer_wheel[slot % TIMER_WHEEL_SIZE], &c->elem);
+	intr_set_level (old_level);
+}
+
+/* Cancels C.  Returns true if C was pending, false if it had
+   already fired or was never added. */
+bool
+timer_callout_cancel (struct timer_callout *c) {
+	enum intr_level old_level;
+	bool was_pending;
+
+	ASSERT (c != NULL);
+
+	old_level = intr_disable ();
+	was_pending = c->pending;
+	if (was_pending) {
+		list_remove (&c->elem);
+		c->pending = false;
+	}
+	intr_set_level (old_level);
+	return was_pending;
+}
+
+/* Fires the callouts that are due at the current tick. */
+static void
+timer_run_callouts (void) {
+	struct list *slot = &timer_wheel[ticks % TIMER_WHEEL_SIZE];
+	struct list_elem *e = list_begin (slot);
+
+	while (e != list_end (slot)) {
+		struct timer_callout *c = list_entry (e, struct timer_callout, elem);
+
+		if (c->expires <= ticks) {
+			e = list_remove (e);
+			c->pending = false;
+			c->func (c->aux);
+		} else
+			e = list_next (e);
+	}
+}
 
+/* Called by the idle thread, with interrupts off, just before it
+   halts the CPU.  If no callout is due at the next tick, switches
+   the PIT to one-shot mode so that it stays quiet until the next
+   deadline, or as long as the 16-bit counter allows. */
+void
+timer_idle_enter (void) {
+	int64_t deadline;
+	int n;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+	if (oneshot_ticks > 0)
+		return;
+
+	deadline = timer_next_deadline (UINT16_MAX / pit_count);
+
+	/* The once-a-second MLFQS work has to run in the interrupt
+	   handler, so never sleep past a second boundary. */
+	if (thread_mlfqs) {
+		int64_t second = ticks - ticks % TIMER_FREQ + TIMER_FREQ;
+		if (deadline > second)
+			deadline = second;
+	}
+	n = deadline - ticks;
+	if (n <= 1)
+		return;
+
+	oneshot_ticks = n;
+	oneshot_count = n * pit_count;
+	outb (0x43, 0x30);    /* CW: counter 0, LSB then MSB, mode 0, binary. */
+	outb (0x40, oneshot_count & 0xff);
+	outb (0x40, oneshot_count >> 8);
+}
+
+/* Called by the scheduler, with interrupts off, when it switches
+   away from the idle thread.  If an interrupt other than the timer
+   woke us, works out how many ticks went by from the PIT's remaining
+   count, catches up on them and goes back to periodic mode.  The
+   callouts that came due meanwhile run here; a thread they wake
+   waits for the next preemption point. */
+void
+timer_idle_exit (void) {
+	uint16_t remaining;
+	int n;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+	if (oneshot_ticks == 0)
+		return;
+
+	/* Read back counter 0's status.  If its output is high, the
+	   one-shot has already expired and its interrupt is pending; the
+	   interrupt handler will do the accounting. */
+	outb (0x43, 0xe2);
+	if (inb (0x40) & 0x80)
+		return;
+
+	outb (0x43, 0x00);    /* Latch counter 0. */
+	remaining = inb (0x40);
+	remaining |= inb (0x40) << 8;
+
+	n = (oneshot_count - remaining) / pit_count;
+	oneshot_ticks = 0;
+	pit_set_periodic ();
+
+	/* Not in the interrupt handler, so only the per-tick work that
+	   cannot yield.  timer_idle_enter() keeps us short of a second
+	   boundary. */
+	while (n-- > 0) {
+		ticks++;
+		thread_idle_tick ();
+		if (thread_mlfqs && ticks % 4 == 0)
+			mlfqs_recalc_priority ();
+		timer_run_callouts ();
+	}
+}
+
+/* Programs the PIT to interrupt every PIT_COUNT input cycles. */
+static void
+pit_set_periodic (void) {
+	outb (0x43, 0x34);    /* CW: counter 0, LSB then MSB, mode 2, binary. */
+	outb (0x40, pit_count & 0xff);
+	outb (0x40, pit_count >> 8);
+}
+
+/* Returns the earliest tick, no more than LIMIT ticks from now, at
+   which a callout is due, or now + LIMIT if there is none. */
+static int64_t
+timer_next_deadline (int64_t limit) {
+	int64_t t;
+
+	ASSERT (limit < TIMER_WHEEL_SIZE);
+	for (t = ticks + 1; t < ticks + limit; t++) {
+		struct list *slot = &timer_wheel[t % TIMER_WHEEL_SIZE];
+		struct list_elem *e;
+
+		for (e = list_begin (slot); e != list_end (slot); e = list_next (e))
+			if (list_entry (e, struct timer_callout, elem)->expires <= t)
+				return t;
+	}
+	return ticks + limit;
+}
+
 /* Timer interrupt handler. */
 static void
 timer_interrupt (struct intr_frame *args UNUSED) {
+	int n = 1;
+
+	if (oneshot_ticks > 0) {
+		n = oneshot_ticks;
+		oneshot_ticks = 0;
+		pit_set_periodic ();
+	}
+
+	while (n-- > 0)
+		timer_tick ();
+}
+
+/* Advances the tick count by one and does the per-tick work. */
+static void
+timer_tick (void) {
 	ticks++;
 	thread_tick ();
 	if(thread_mlfqs){
@@ -142,7 +356,7 @@ timer_interrupt (struct intr_frame *args UNUSED) {
 			}
 		}
 	}
-	thread_wake(ticks);
+	timer_run_callouts ();
 }
 
 /* Returns true if LOOPS iterations waits for more than one timer
@@ -0,0 +1,180 @@
+/* tty.c: Line discipline for console input.
+ *
+ * Sits between the raw key queue of input.c and readers of standard
+ * input.  In canonical mode, keys are collected into a line that can be
+ * edited with backspace (erase a character) and ^U (erase the line), and
+ * only complete lines, ended by newline or ^D, are handed to readers.
+ * ^D on an empty line reads as end of file.  Otherwise every key is
+ * passed on as soon as it arrives.  A reader gets as many bytes as are
+ * available, up to the size it asked for, in one call; the rest waits
+ * for the next read. */
+
+#include "devices/tty.h"
+#include <debug.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "devices/input.h"
+#include "threads/interrupt.h"
+#include "threads/synch.h"
+
+#define CTRL_D 0x04             /* End of file. */
+#define CTRL_U 0x15             /* Kill line. */
+#define BS     0x08             /* Backspace. */
+#define DEL    0x7f             /* Delete, sent by most terminals. */
+
+static struct lock tty_lock;    /* One reader at a time. */
+static int tty_mode;            /* TTY_* flags. */
+
+/* Input held by the line discipline.  The first READY bytes of LINE are
+ * cooked and can be handed out; bytes up to LEN are still being edited. */
+static char line[TTY_LINE_MAX];
+static size_t ready;
+static size_t len;
+static bool eof;                /* ^D on an empty line is pending. */
+
+static bool tty_get_key (uint8_t *key, bool block);
+static void tty_process (uint8_t key);
+static void tty_echo (const char *s, size_t n);
+
+void
+tty_init (void) {
+	lock_init (&tty_lock);
+	lock_set_name (&tty_lock, "tty");
+	tty_mode = TTY_DEFAULT;
+}
+
+/* Reads up to SIZE bytes of console input into BUFFER.  Waits for a
+ * complete line in canonical mode, or for a single key otherwise, unless
+ * the console is in non-blocking mode.  Returns the number of bytes read,
+ * 0 at end of file, or -1 if nothing is available without waiting. */
+int
+tty_read (void *buffer, size_t size) {
+	int result;
+
+	if (size == 0)
+		return 0;
+
+	lock_acquire (&tty_lock);
+	for (;;) {
+		uint8_t key;
+
+		if (ready > 0 || eof)
+			break;
+		if (!tty_get_key (&key, !(tty_mode & TTY_NONBLOCK))) {
+			lock_release (&tty_lock);
+			return -1;
+		}
+		tty_process (key);
+	}
+
+	/* Drain whatever else arrived meanwhile without waiting. */
+	if (!(tty_mode & TTY_CANON)) {
+		uint8_t key;
+		while (ready < size && len < TTY_LINE_MAX && tty_get_key (&key, false))
+			tty_process (key);
+	}
+
+	if (ready == 0) {
+		/* End of file. */
+		eof = false;
+		result = 0;
+	} else {
+		result = ready < size ? ready : size;
+		memcpy (buffer, line, result);
+		memmove (line, line + result, len - result);
+		ready -= result;
+		len -= result;
+	}
+	lock_release (&tty_lock);
+	return result;
+}
+
+/* Sets the console input mode to MODE, a combination of TTY_* flags,
+ * and returns the previous mode.  Input being edited becomes readable
+ * when canonical mode is turned off. */
+int
+tty_set_mode (int mode) {
+	int old;
+
+	lock_acquire (&tty_lock);
+	old = tty_mode;
+	tty_mode = mode & (TTY_CANON | TTY_ECHO | TTY_NONBLOCK);
+	if (!(tty_mode & TTY_CANON))
+		ready = len;
+	lock_release (&tty_lock);
+	return old;
+}
+
+/* Fetches the next raw key into *KEY.  If BLOCK is false and no key is
+ * queued, returns false instead of waiting. */
+static bool
+tty_get_key (uint8_t *key, bool block) {
+	enum intr_level old_level;
+	bool available;
+
+	if (block) {
+		*key = input_getc ();
+		return true;
+	}
+
+	old_level = intr_disable ();
+	available = !input_empty ();
+	intr_set_level (old_level);
+	if (available)
+		*key = input_getc ();
+	return available;
+}
+
+/* Applies KEY to the line being edited. */
+static void
+tty_process (uint8_t key) {
+	if (key == '\r')
+		key = '\n';
+
+	if (!(tty_mode & TTY_CANON)) {
+		if (len < TTY_LINE_MAX) {
+			line[len++] = key;
+			ready = len;
+			tty_echo ((char *) &key, 1);
+		}
+		return;
+	}
+
+	switch (key) {
+		case BS:
+		case DEL:
+			if (len > ready) {
+				len--;
+				tty_echo ("\b \b", 3);
+			}
+			break;
+		case CTRL_U:
+			while (len > ready) {
+				len--;
+				tty_echo ("\b \b", 3);
+			}
+			break;
+		case CTRL_D:
+			if (len == ready)
+				eof = true;
+			ready = len;
+			break;
+		default:
+			if (len < TTY_LINE_MAX) {
+				line[len++] = key;
+				tty_echo ((char *) &key, 1);
+			}
+			/* A full line is handed out as is. */
+			if (key == '\n' || len == TTY_LINE_MAX)
+				ready = len;
+			break;
+	}
+}
+
+static void
+tty_echo (const char *s, size_t n) {
+	if (tty_mode & TTY_ECHO)
+		putbuf (s, n);
+}
@@ -33,6 +33,7 @@ struct inode {
 	int open_cnt;                       /* Number of openers. */
 	bool removed;                       /* True if deleted, false otherwise. */
 	int deny_write_cnt;                 /* 0: writes ok, >0: deny writes. */
+	unsigned generation;                /* Bumped on every write and removal. */
 	struct inode_disk data;             /* Inode content. */
 };
 
@@ -125,6 +126,7 @@ inode_open (disk_sector_t sector) {
 	inode->open_cnt = 1;
 	inode->deny_write_cnt = 0;
 	inode->removed = false;
+	inode->generation = 0;
 	disk_read (filesys_disk, inode->sector, &inode->data);
 	return inode;
 }
@@ -174,6 +176,7 @@ void
 inode_remove (struct inode *inode) {
 	ASSERT (inode != NULL);
 	inode->removed = true;
+	inode->generation++;
 }
 
 /* Reads SIZE bytes from INODE into BUFFER, starting at position OFFSET.
@@ -239,6 +242,7 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
 
 	if (inode->deny_write_cnt)
 		return 0;
+	inode->generation++;
 
 	while (size > 0) {
 		/* Sector to write, starting byte offset within sector. */
@@ -306,6 +310,14 @@ inode_allow_write (struct inode *inode) {
 	inode->deny_write_cnt--;
 }
 
+/* Returns INODE's generation, which changes whenever INODE's data is
+ * written or INODE is removed.  Lets callers that cache something derived
+ * from the contents tell whether their copy is still current. */
+unsigned
+inode_get_generation (const struct inode *inode) {
+	return inode->generation;
+}
+
 /* Returns the length, in bytes, of INODE's data. */
 off_t
 inode_length (const struct inode *inode) {
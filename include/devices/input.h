@@ -7,6 +7,7 @@
 void input_init (void);
 void input_putc (uint8_t);
 uint8_t input_getc (void);
+bool input_empty (void);
 bool input_full (void);
 
 #endif /* devices/input.h */
@@ -1,15 +1,41 @@
 #ifndef DEVICES_TIMER_H
 #define DEVICES_TIMER_H
 
+#include <list.h>
 #include <round.h>
+#include <stdbool.h>
 #include <stdint.h>
 
-/* Number of timer interrupts per second. */
-#define TIMER_FREQ 100
+/* Number of timer interrupts per second.  Defaults to
+   TIMER_FREQ_DEFAULT and may be changed at boot with -hz=N. */
+#define TIMER_FREQ_DEFAULT 100
+#define TIMER_FREQ_MIN 19               /* 8254 counter is 16 bits wide. */
+#define TIMER_FREQ_MAX 1000
+extern int timer_freq;
+#define TIMER_FREQ timer_freq
 
+/* A function to run from the timer interrupt once a deadline has
+   passed.  It runs with interrupts off in the interrupt context, so
+   it must not sleep. */
+typedef void timer_callout_func (void *aux);
+
+/* A deferred call.  The caller owns the storage, which must stay
+   valid until the callout has fired or been cancelled. */
+struct timer_callout {
+	int64_t expires;                    /* Tick at which to fire. */
+	timer_callout_func *func;           /* Function to call. */
+	void *aux;                          /* Argument to FUNC. */
+	bool pending;                       /* Queued and not yet fired? */
+	struct list_elem elem;              /* Element in a wheel slot. */
+};
+
+void timer_set_freq (int hz);
 void timer_init (void);
 void timer_calibrate (void);
 
+void timer_idle_enter (void);
+void timer_idle_exit (void);
+
 int64_t timer_ticks (void);
 int64_t timer_elapsed (int64_t);
 
@@ -20,4 +46,9 @@ void timer_nsleep (int64_t nanoseconds);
 
 void timer_print_stats (void);
 
+void timer_callout_init (struct timer_callout *, timer_callout_func *,
+		void *aux);
+void timer_callout_add (struct timer_callout *, int64_t expires);
+bool timer_callout_cancel (struct timer_callout *);
+
 #endif /* devices/timer.h */
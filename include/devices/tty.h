@@ -0,0 +1,13 @@
+#ifndef DEVICES_TTY_H
+#define DEVICES_TTY_H
+
+#include <stddef.h>
+#include <tty.h>
+
+/* Longest line held by the line discipline, in bytes. */
+#define TTY_LINE_MAX 256
+
+void tty_init (void);
+int tty_read (void *buffer, size_t size);
+int tty_set_mode (int mode);
+#endif /* devices/tty.h */
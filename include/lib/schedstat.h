@@ -0,0 +1,17 @@
+#ifndef __LIB_SCHEDSTAT_H
+#define __LIB_SCHEDSTAT_H
+
+#include <stdint.h>
+
+/* Per-thread scheduler statistics, as returned by the schedstat
+   system call.  Times are in timer ticks. */
+struct schedstat {
+	int64_t user_ticks;             /* Ticks running in user mode. */
+	int64_t kernel_ticks;           /* Ticks running in the kernel. */
+	int64_t ready_ticks;            /* Ticks runnable but not running. */
+	int64_t lock_wait_ticks;        /* Ticks blocked in lock_acquire(). */
+	int64_t voluntary_switches;     /* Gave up the CPU by blocking. */
+	int64_t involuntary_switches;   /* Preempted while still runnable. */
+};
+
+#endif /* lib/schedstat.h */
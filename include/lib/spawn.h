@@ -0,0 +1,26 @@
+#ifndef __LIB_SPAWN_H
+#define __LIB_SPAWN_H
+
+/* File descriptor actions for the spawn system call.
+
+   A spawned child starts with a duplicate of every file descriptor
+   of its parent, just as after fork().  The actions passed to spawn()
+   are then applied to the child's descriptor table in order, before
+   the new program is loaded.  If any action is invalid, the spawn
+   fails. */
+enum spawn_action_type {
+	SPAWN_CLOSE,                /* Close FD. */
+	SPAWN_DUP2,                 /* Make NEWFD a duplicate of FD. */
+	SPAWN_CLOSEFROM,            /* Close FD and every descriptor above it. */
+};
+
+struct spawn_action {
+	int type;                   /* One of enum spawn_action_type. */
+	int fd;
+	int newfd;                  /* SPAWN_DUP2 only. */
+};
+
+/* Maximum number of actions accepted by one spawn() call. */
+#define SPAWN_ACTIONS_MAX 16
+
+#endif /* lib/spawn.h */
@@ -36,6 +36,17 @@ enum {
 
 	SYS_MOUNT,
 	SYS_UMOUNT,
+
+	/* Extensions. */
+	SYS_SCHEDSTAT,              /* Get a thread's scheduler statistics. */
+	SYS_SPAWN,                  /* Start a new process from an executable. */
+	SYS_READV,                  /* Read from a file into several buffers. */
+	SYS_WRITEV,                 /* Write several buffers to a file. */
+	SYS_PREAD,                  /* Read from a file at a given offset. */
+	SYS_PWRITE,                 /* Write to a file at a given offset. */
+	SYS_SENDFILE,               /* Copy data between two descriptors. */
+	SYS_URING_ENTER,            /* Carry out queued ring submissions. */
+	SYS_TTYMODE,                /* Set the console input mode. */
 };
 
 #endif /* lib/syscall-nr.h */
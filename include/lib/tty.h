@@ -0,0 +1,14 @@
+#ifndef __LIB_TTY_H
+#define __LIB_TTY_H
+
+/* Console input modes, for the ttymode system call. */
+#define TTY_CANON    0x1        /* Line editing; read() returns lines. */
+#define TTY_ECHO     0x2        /* Echo input back to the console. */
+#define TTY_NONBLOCK 0x4        /* read() fails instead of waiting. */
+
+/* Modes at boot.  Echo is off, so that programs reading standard input
+   produce the same output as before the line discipline existed; an
+   interactive shell turns it on with ttymode(). */
+#define TTY_DEFAULT TTY_CANON
+
+#endif /* lib/tty.h */
@@ -0,0 +1,52 @@
+#ifndef __LIB_URING_H
+#define __LIB_URING_H
+
+#include <stdint.h>
+
+/* Batched system call ring, for the uring_enter system call.
+
+   The ring lives in ordinary user memory shared with the kernel.  The
+   user fills submission queue entries at SQ_TAIL and advances it; one
+   uring_enter() call then has the kernel carry out every entry between
+   SQ_HEAD and SQ_TAIL, advancing SQ_HEAD, and post one completion per
+   entry at CQ_TAIL.  The user consumes completions from CQ_HEAD.
+   Indices run freely and are reduced modulo URING_ENTRIES. */
+
+/* Entries in each queue.  Must be a power of 2. */
+#define URING_ENTRIES 64
+
+/* Operations. */
+enum uring_op {
+	URING_OP_NOP,               /* Do nothing; completes with 0. */
+	URING_OP_READ,              /* read(), or pread() if OFF >= 0. */
+	URING_OP_WRITE,             /* write(), or pwrite() if OFF >= 0. */
+	URING_OP_OPEN,              /* open() the file named at ADDR. */
+	URING_OP_CLOSE,             /* close() FD; completes with 0. */
+};
+
+/* Submission queue entry. */
+struct uring_sqe {
+	uint32_t opcode;            /* One of enum uring_op. */
+	int32_t fd;                 /* File descriptor. */
+	uint64_t addr;              /* Buffer or file name. */
+	uint32_t len;               /* Buffer length. */
+	int64_t off;                /* File offset, or -1 for the position. */
+	uint64_t user_data;         /* Copied into the completion. */
+};
+
+/* Completion queue entry. */
+struct uring_cqe {
+	uint64_t user_data;         /* From the submission. */
+	int64_t res;                /* What the system call returned. */
+};
+
+struct uring {
+	uint32_t sq_head;           /* Advanced by the kernel. */
+	uint32_t sq_tail;           /* Advanced by the user. */
+	uint32_t cq_head;           /* Advanced by the user. */
+	uint32_t cq_tail;           /* Advanced by the kernel. */
+	struct uring_sqe sqes[URING_ENTRIES];
+	struct uring_cqe cqes[URING_ENTRIES];
+};
+
+#endif /* lib/uring.h */
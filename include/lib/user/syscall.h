@@ -4,6 +4,11 @@
 #include <stdbool.h>
 #include <debug.h>
 #include <stddef.h>
+#include <schedstat.h>
+#include <spawn.h>
+#include <iovec.h>
+#include <uring.h>
+#include <tty.h>
 
 /* Process identifier. */
 typedef int pid_t;
@@ -50,6 +55,18 @@ bool isdir (int fd);
 int inumber (int fd);
 int symlink (const char* target, const char* linkpath);
 
+/* Extensions. */
+bool schedstat (pid_t, struct schedstat *);
+pid_t spawn (const char *cmd_line, const struct spawn_action *actions,
+		int action_cnt);
+int readv (int fd, const struct iovec *iov, int iovcnt);
+int writev (int fd, const struct iovec *iov, int iovcnt);
+int pread (int fd, void *buffer, unsigned length, off_t offset);
+int pwrite (int fd, const void *buffer, unsigned length, off_t offset);
+int sendfile (int out_fd, int in_fd, off_t *offset, unsigned count);
+int uring_enter (struct uring *ring, unsigned to_submit);
+int ttymode (int mode);
+
 static inline void* get_phys_addr (void *user_addr) {
 	void* pa;
 	asm volatile ("movq %0, %%rax" ::"r"(user_addr));
@@ -41,5 +41,10 @@
 #define PTE_U 0x4                        /* 1=user/kernel, 0=kernel only. */
 #define PTE_A 0x20                       /* 1=accessed, 0=not acccessed. */
 #define PTE_D 0x40                       /* 1=dirty, 0=not dirty (PTEs only). */
+#define PTE_PS 0x80                      /* 1=2 MiB page (PDEs only). */
+
+/* Size of a page mapped directly by a page directory entry. */
+#define LPGSIZE (1UL << PDXSHIFT)
+#define lpg_ofs(va) ((uint64_t) (va) & (LPGSIZE - 1))
 
 #endif /* threads/pte.h */
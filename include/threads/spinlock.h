@@ -0,0 +1,41 @@
+#ifndef THREADS_SPINLOCK_H
+#define THREADS_SPINLOCK_H
+
+#include <list.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "threads/interrupt.h"
+
+/* Contention statistics kept by every lock and spinlock.  Locks
+   that are given a name are listed by lock_print_stats(). */
+struct lock_stats {
+	const char *name;           /* Name, or null if not registered. */
+	uint64_t acquires;          /* # of times acquired. */
+	uint64_t contended;         /* # of acquires that had to wait. */
+	uint64_t max_hold;          /* Longest hold, in TSC cycles. */
+	uint64_t hold_start;        /* TSC at the last acquire. */
+	struct list_elem elem;      /* Element in the list of named locks. */
+};
+
+void lock_stats_init (void);
+void lock_stats_register (struct lock_stats *, const char *name);
+void lock_stats_acquired (struct lock_stats *, bool contended);
+void lock_stats_released (struct lock_stats *);
+void lock_print_stats (void);
+
+/* Ticket spinlock.  Acquiring it also disables interrupts on the
+   local CPU, so it may be used in interrupt handlers and must only
+   be held for short, non-sleeping critical sections. */
+struct spinlock {
+	unsigned next_ticket;       /* Next ticket to hand out. */
+	unsigned now_serving;       /* Ticket allowed to hold the lock. */
+	enum intr_level old_level;  /* Interrupt level before acquire. */
+	struct lock_stats stats;    /* Contention statistics. */
+};
+
+void spinlock_init (struct spinlock *, const char *name);
+void spinlock_acquire (struct spinlock *);
+void spinlock_release (struct spinlock *);
+bool spinlock_is_locked (const struct spinlock *);
+
+#endif /* threads/spinlock.h */
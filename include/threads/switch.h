@@ -0,0 +1,27 @@
+#ifndef THREADS_SWITCH_H
+#define THREADS_SWITCH_H
+
+#include <stdint.h>
+
+/* switch_threads()'s stack frame.  Only the registers the System V
+   ABI makes callee-saved are kept; everything else is dead across
+   the call to switch_threads() anyway. */
+struct switch_threads_frame {
+	uint64_t r15;               /*  0: Saved %r15. */
+	uint64_t r14;               /*  8: Saved %r14. */
+	uint64_t r13;               /* 16: Saved %r13. */
+	uint64_t r12;               /* 24: Saved %r12. */
+	uint64_t rbx;               /* 32: Saved %rbx. */
+	uint64_t rbp;               /* 40: Saved %rbp. */
+	void (*rip) (void);         /* 48: Return address. */
+};
+
+/* Saves the current stack pointer in *CUR_RSP and switches to the
+   stack at NEXT_RSP, which must hold a struct switch_threads_frame. */
+void switch_threads (void **cur_rsp, void *next_rsp);
+
+/* First code run by a new thread: calls the function in %rbx with
+   %r12 and %r13 as its arguments. */
+void switch_entry (void);
+
+#endif /* threads/switch.h */
@@ -4,12 +4,15 @@
 #include <debug.h>
 #include <list.h>
 #include <stdint.h>
+#include <schedstat.h>
 #include "threads/interrupt.h"
 #include "threads/synch.h"
+#include "devices/timer.h"
 #ifdef VM
 #include "vm/vm.h"
 #endif
 
+struct fd_table;
 
 /* States in a thread's life cycle. */
 enum thread_status {
@@ -29,7 +32,6 @@ typedef int tid_t;
 #define PRI_DEFAULT 31                  /* Default priority. */
 #define PRI_MAX 63                      /* Highest priority. */
 
-#define MAX_FDT 128
 /* A kernel thread or user process.
  *
  * Each thread structure is stored in its own 4 kB page.  The
@@ -108,15 +110,27 @@ struct thread {
 	void *stack_bottom;
 #endif
 
-	int64_t wake_tick;	
+	struct timer_callout sleep_timer;   /* Wakes the thread from thread_sleep(). */
 
+	struct list *wait_list;             /* Semaphore wait list we are on. */
+	bool sema_handoff;                  /* Woken by sema_up() with the unit
+	                                       already handed to us. */
 	struct lock *wait_on_lock;
-	struct list donations;
-	struct list_elem d_elem;
+	struct thread *donors;              /* Max-heap of threads donating to us. */
+	struct thread *donor_child;         /* Our node in a holder's donor heap: */
+	struct thread *donor_prev;          /*   first child, parent or left */
+	struct thread *donor_next;          /*   sibling, right sibling. */
 	int origin_priority;
 
+	struct schedstat stats;             /* Scheduler statistics. */
+	int64_t ready_since;                /* Tick at which we became ready. */
+
 	int nice;
 	int recent_cpu;
+	bool mlfqs_dirty;                   /* recent_cpu changed since the last
+	                                       priority recomputation. */
+	struct list_elem mlfqs_elem;        /* Element in the MLFQS dirty list. */
+	struct list_elem all_elem;          /* Element in the all-threads list. */
 
 	int is_exit; //프로세스 종료 유무
 	
@@ -128,14 +142,14 @@ struct thread {
 	struct list_elem child_elem; //자식 프로세스 리스트 요소
 
 
-	struct file *fdt[MAX_FDT];
-	int next_fd;
+	struct fd_table *fdt;                /* Open files; null for kernel threads. */
 
 	struct file *running_file;
 
 	struct intr_frame parent_if; //부모프로세스 디스크립터 포인트 필드
 
 	/* Owned by thread.c. */
+	void *switch_rsp;                   /* Saved stack pointer while switched out. */
 	struct intr_frame tf;               /* Information for switching */
 	unsigned magic;                     /* Detects stack overflow. */
 };
@@ -149,7 +163,10 @@ void thread_init (void);
 void thread_start (void);
 
 void thread_tick (void);
+void thread_idle_tick (void);
 void thread_print_stats (void);
+void thread_print_schedstats (void);
+bool thread_get_schedstat (tid_t, struct schedstat *);
 
 typedef void thread_func (void *aux);
 tid_t thread_create (const char *name, int priority, thread_func *, void *);
@@ -175,12 +192,10 @@ int thread_get_load_avg (void);
 void do_iret (struct intr_frame *tf);
 
 void thread_sleep(int64_t start, int64_t ticks);
-void thread_wake(int64_t ticks);
 
 bool cmp_priority (const struct list_elem *a_, const struct list_elem *b_, void *aux UNUSED);
-bool cmp_wake_ticks (const struct list_elem *a_, const struct list_elem *b_, void *aux UNUSED);
-bool cmp_doner_priority (const struct list_elem *a_, const struct list_elem *b_, void *aux UNUSED);
 void thread_change_by_priority(void);
+void thread_update_priority (struct thread *t, int priority);
 
 //MLFQS
 void mlfqs_priority(struct thread *t);
@@ -0,0 +1,36 @@
+#ifndef USERPROG_FDTABLE_H
+#define USERPROG_FDTABLE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+struct file;
+
+/* Number of descriptors a new table has room for. */
+#define FDT_INIT_SIZE 64
+/* Descriptors are always below this value. */
+#define FDT_MAX 4096
+
+/* A process's file descriptor table.
+ * Descriptors 0 and 1 are the console unless a file is installed in
+ * their place, and are never handed out by fd_table_add(). */
+struct fd_table {
+	int ref_cnt;                /* Processes sharing this table. */
+	int size;                   /* Slots in FILES, a multiple of 64. */
+	int hint;                   /* No free slot in USED below this word. */
+	struct file **files;        /* Open file of each descriptor. */
+	uint64_t *used;             /* Bitmap of allocated descriptors. */
+};
+
+void fd_table_init (void);
+struct fd_table *fd_table_create (void);
+struct fd_table *fd_table_share (struct fd_table *);
+bool fd_table_unshare (struct fd_table **);
+void fd_table_release (struct fd_table *);
+
+struct file *fd_table_get (const struct fd_table *, int fd);
+int fd_table_add (struct fd_table *, struct file *);
+bool fd_table_install (struct fd_table *, int fd, struct file *);
+struct file *fd_table_remove (struct fd_table *, int fd);
+
+#endif /* userprog/fdtable.h */
@@ -3,10 +3,13 @@
 
 #include "threads/thread.h"
 #include "filesys/off_t.h"
+#include <spawn.h>
 
 
 tid_t process_create_initd (const char *file_name);
 tid_t process_fork (const char *name, struct intr_frame *if_);
+tid_t process_spawn (char *cmd_line, const struct spawn_action *actions,
+		int action_cnt);
 struct container{
     struct file *file;
     off_t ofs;
@@ -17,8 +20,10 @@ int process_exec (void *f_name);
 int process_wait (tid_t);
 void process_exit (void);
 void process_activate (struct thread *next);
+bool process_is_console (int fd);
 struct file *process_get_file(int fd);
 int process_add_file(struct file *file);
+struct file *process_remove_file (int fd);
+void process_exec_cache_purge (void);
 bool lazy_load_segment (struct page *page, void *aux);
-#define MAX_FDT 128
 #endif /* userprog/process.h */
@@ -4,10 +4,13 @@
 #include <stdbool.h>
 #include <debug.h>
 #include <stddef.h>
+#include <schedstat.h>
+#include <spawn.h>
+#include <iovec.h>
+#include <uring.h>
+#include <tty.h>
 #include "threads/interrupt.h"
 
-#define MAX_FDT 128
-
 typedef int pid_t;
 #define PID_ERROR ((pid_t) -1)
 
@@ -35,7 +38,18 @@ void seek (int fd, unsigned position);
 unsigned tell (int fd);
 void close (int fd);
 int dup2 (int oldfd, int newfd);
-struct page *check_address(void *addr);
+struct page *check_address(const void *addr);
+void check_valid_buffer (const void *buffer, unsigned size, bool is_read);
+bool schedstat (pid_t pid, struct schedstat *st);
+pid_t spawn (const char *cmd_line, const struct spawn_action *actions,
+		int action_cnt);
+int readv (int fd, const struct iovec *iov, int iovcnt);
+int writev (int fd, const struct iovec *iov, int iovcnt);
+int pread (int fd, void *buffer, unsigned length, off_t offset);
+int pwrite (int fd, const void *buffer, unsigned length, off_t offset);
+int sendfile (int out_fd, int in_fd, off_t *offset, unsigned count);
+int uring_enter (struct uring *ring, unsigned to_submit);
+int ttymode (int mode);
 void *mmap(void *addr, size_t length, int writable, int fd, off_t offset);
 void munmap(void *addr);
 #endif /* userprog/syscall.h */
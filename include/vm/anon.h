@@ -3,6 +3,7 @@
 #include "vm/vm.h"
 struct page;
 enum vm_type;
+struct zswap_entry;
 
 struct anon_page {
     vm_initializer *init;
@@ -11,9 +12,12 @@ struct anon_page {
 	/* Initiate the struct page and maps the pa to the va */
 	bool (*page_initializer) (struct page *, enum vm_type, void *kva);
     int swap_index;
+    struct zswap_entry *zswap;  /* Compressed copy, if in the swap cache. */
 };
 
 void vm_anon_init (void);
 bool anon_initializer (struct page *page, enum vm_type type, void *kva);
+int swap_slot_write (const void *kva);
+bool swap_slot_read (int page_no, void *kva);
 
 #endif
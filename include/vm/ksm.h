@@ -0,0 +1,11 @@
+#ifndef VM_KSM_H
+#define VM_KSM_H
+#include "vm/vm.h"
+
+/* Ticks between two scans of the frame table. */
+#define KSM_SCAN_TICKS 100
+
+void ksm_init (void);
+void ksm_unshared (struct page *page);
+void ksm_print_stats (void);
+#endif
@@ -0,0 +1,22 @@
+#ifndef VM_TEXTCACHE_H
+#define VM_TEXTCACHE_H
+#include "vm/vm.h"
+#include "filesys/off_t.h"
+
+struct inode;
+
+/* Identifies the contents of a page of an executable. */
+struct text_key {
+	struct inode *inode;        /* Executable the page belongs to. */
+	unsigned generation;        /* Inode generation when the page was read. */
+	off_t ofs;                  /* Offset of the page in the file. */
+	size_t read_bytes;          /* Bytes read from the file. */
+};
+
+void text_cache_init (void);
+bool text_cache_key (struct page *page, struct text_key *key);
+struct frame *text_cache_lookup (const struct text_key *key);
+void text_cache_insert (struct frame *frame, const struct text_key *key);
+void text_cache_remove (struct frame *frame);
+void text_cache_print_stats (void);
+#endif
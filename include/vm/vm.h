@@ -52,6 +52,8 @@ struct page {
 	struct hash_elem hash_elem;
 	int mapped_page_count;
 	bool writable;
+	struct thread *owner;          /* Thread whose pml4 maps this page. */
+	struct list_elem share_elem;   /* Element in frame's sharers list. */
 	/* Per-type data are binded into the union.
 	 * Each function automatically detects the current union */
 	union {
@@ -69,6 +71,10 @@ struct frame {
 	void *kva;
 	struct page *page;
 	struct list_elem frame_elem;
+	int ref_cnt;                   /* Number of pages mapping this frame. */
+	struct list sharers;           /* Pages mapping this frame. */
+	struct text_page *text;        /* Text cache entry, if any. */
+	bool loading;                  /* Contents not in place yet. */
 };
 
 /* The function table for page operations.
@@ -104,6 +110,9 @@ struct page *spt_find_page (struct supplemental_page_table *spt,
 bool spt_insert_page (struct supplemental_page_table *spt, struct page *page);
 void spt_remove_page (struct supplemental_page_table *spt, struct page *page);
 
+extern struct list frame_table;
+extern struct lock frame_lock;
+
 void vm_init (void);
 bool vm_try_handle_fault (struct intr_frame *f, void *addr, bool user,
 		bool write, bool not_present);
@@ -121,4 +130,7 @@ void spt_destructor(struct hash_elem *e, void *aux);
 void *undo_mmap(void *initial_addr, void *addr);
 bool insert_page(struct hash *pages, struct page *p);
 bool delete_page(struct hash *pages, struct page *p);
+void frame_share (struct frame *frame, struct page *page);
+void frame_release (struct page *page);
+void frame_table_remove (struct frame *frame);
 #endif  /* VM_VM_H */
@@ -0,0 +1,25 @@
+#ifndef VM_ZSWAP_H
+#define VM_ZSWAP_H
+#include "vm/vm.h"
+
+/* Pages of kernel memory holding compressed anonymous pages. */
+#define ZSWAP_POOL_PAGES 256
+/* Allocation unit inside the pool, in bytes. */
+#define ZSWAP_SLOT_SIZE 256
+/* Pages compressing worse than this go straight to the swap disk. */
+#define ZSWAP_MAX_LEN (PGSIZE * 3 / 4)
+
+/* A compressed page held in the pool. */
+struct zswap_entry {
+	struct page *page;          /* Anonymous page this data belongs to. */
+	size_t slot;                /* First pool slot. */
+	size_t len;                 /* Compressed length in bytes. */
+	struct list_elem lru_elem;  /* Element in the LRU list. */
+};
+
+void zswap_init (void);
+bool zswap_store (struct page *page, const void *kva);
+bool zswap_load (struct page *page, void *kva);
+void zswap_invalidate (struct page *page);
+void zswap_print_stats (void);
+#endif
@@ -0,0 +1,19 @@
+/* Child process run by the spawn-dup2 test.
+   Copies its standard input to its standard output. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+
+const char *test_name = "child-cat";
+
+int
+main (void) 
+{
+  char buf[64];
+  int n;
+
+  while ((n = read (0, buf, sizeof buf)) > 0)
+    if (write (1, buf, n) != n)
+      fail ("short write");
+  return n < 0;
+}
@@ -0,0 +1,21 @@
+/* Child process run by the spawn-closefrom test.
+   Returns how many of the file descriptors named on its command
+   line are open. */
+
+#include <stdlib.h>
+#include <syscall.h>
+#include "tests/lib.h"
+
+const char *test_name = "child-fds";
+
+int
+main (int argc, char *argv[]) 
+{
+  int open_cnt = 0;
+  int i;
+
+  for (i = 1; i < argc; i++)
+    if (filesize (atoi (argv[i])) >= 0)
+      open_cnt++;
+  return open_cnt;
+}
@@ -0,0 +1,32 @@
+/* Passes readv() and writev() buffer counts that are out of range,
+   which must return -1, and IOV_MAX buffers, which must work. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  static struct iovec iov[IOV_MAX + 1];
+  static char buf[IOV_MAX + 1];
+  int handle;
+  int i;
+
+  CHECK ((handle = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  for (i = 0; i <= IOV_MAX; i++)
+    {
+      iov[i].iov_base = &buf[i];
+      iov[i].iov_len = 1;
+    }
+
+  msg ("readv() of 0 buffers: %d", readv (handle, iov, 0));
+  msg ("readv() of -1 buffers: %d", readv (handle, iov, -1));
+  msg ("readv() of IOV_MAX + 1 buffers: %d",
+       readv (handle, iov, IOV_MAX + 1));
+  msg ("writev() of 0 buffers: %d", writev (1, iov, 0));
+  msg ("writev() of IOV_MAX + 1 buffers: %d",
+       writev (1, iov, IOV_MAX + 1));
+  CHECK (readv (handle, iov, IOV_MAX) == IOV_MAX,
+         "readv() of IOV_MAX buffers");
+}
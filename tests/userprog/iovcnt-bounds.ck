@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(iovcnt-bounds) begin
+(iovcnt-bounds) open "sample.txt"
+(iovcnt-bounds) readv() of 0 buffers: -1
+(iovcnt-bounds) readv() of -1 buffers: -1
+(iovcnt-bounds) readv() of IOV_MAX + 1 buffers: -1
+(iovcnt-bounds) writev() of 0 buffers: -1
+(iovcnt-bounds) writev() of IOV_MAX + 1 buffers: -1
+(iovcnt-bounds) readv() of IOV_MAX buffers
+(iovcnt-bounds) end
+iovcnt-bounds: exit(0)
+EOF
+pass;
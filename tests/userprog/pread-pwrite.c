@@ -0,0 +1,41 @@
+/* Checks that pread() and pwrite() work at the offset they are
+   given and leave the file position alone, and that reading past
+   the end of the file returns 0. */
+
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  size_t size = sizeof sample - 1;
+  char buf[64];
+  int handle;
+
+  CHECK ((handle = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  CHECK (read (handle, buf, 10) == 10, "read 10 bytes");
+  CHECK (pread (handle, buf, 50, 100) == 50, "pread 50 bytes at offset 100");
+  compare_bytes (buf, sample + 100, 50, 100, "sample.txt");
+  CHECK (tell (handle) == 10, "position is still 10");
+  CHECK (pread (handle, buf, sizeof buf, size - 5) == 5,
+         "pread across the end of file");
+  CHECK (pread (handle, buf, sizeof buf, size + 5) == 0,
+         "pread past the end of file");
+  CHECK (pread (handle, buf, sizeof buf, -1) == -1,
+         "pread at a negative offset");
+  close (handle);
+
+  CHECK (create ("test.txt", size), "create \"test.txt\"");
+  CHECK ((handle = open ("test.txt")) > 1, "open \"test.txt\"");
+  CHECK (pwrite (handle, sample + 200, size - 200, 200) == (int) size - 200,
+         "pwrite the end of the sample");
+  CHECK (tell (handle) == 0, "position is still 0");
+  CHECK (write (handle, sample, 200) == 200,
+         "write the start of the sample");
+  CHECK (pwrite (handle, buf, 1, -1) == -1, "pwrite at a negative offset");
+  close (handle);
+
+  check_file ("test.txt", sample, size);
+}
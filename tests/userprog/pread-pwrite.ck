@@ -0,0 +1,26 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(pread-pwrite) begin
+(pread-pwrite) open "sample.txt"
+(pread-pwrite) read 10 bytes
+(pread-pwrite) pread 50 bytes at offset 100
+(pread-pwrite) position is still 10
+(pread-pwrite) pread across the end of file
+(pread-pwrite) pread past the end of file
+(pread-pwrite) pread at a negative offset
+(pread-pwrite) create "test.txt"
+(pread-pwrite) open "test.txt"
+(pread-pwrite) pwrite the end of the sample
+(pread-pwrite) position is still 0
+(pread-pwrite) write the start of the sample
+(pread-pwrite) pwrite at a negative offset
+(pread-pwrite) open "test.txt" for verification
+(pread-pwrite) verified contents of "test.txt"
+(pread-pwrite) close "test.txt"
+(pread-pwrite) end
+pread-pwrite: exit(0)
+EOF
+pass;
@@ -0,0 +1,38 @@
+/* Reads "sample.txt" with readv() into three buffers that together
+   are larger than the file.  The first two must be filled, the third
+   must get the rest, and the file position must end up at the end
+   of the file. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  static char buf[3][256];
+  struct iovec iov[3];
+  size_t size = sizeof sample - 1;
+  int handle, byte_cnt;
+  char c;
+
+  CHECK ((handle = open ("sample.txt")) > 1, "open \"sample.txt\"");
+
+  iov[0].iov_base = buf[0];
+  iov[0].iov_len = 100;
+  iov[1].iov_base = buf[1];
+  iov[1].iov_len = 0;
+  iov[2].iov_base = buf[2];
+  iov[2].iov_len = sizeof buf[2];
+  byte_cnt = readv (handle, iov, 3);
+  if (byte_cnt != (int) size)
+    fail ("readv() returned %d instead of %zu", byte_cnt, size);
+  compare_bytes (buf[0], sample, 100, 0, "sample.txt");
+  compare_bytes (buf[2], sample + 100, size - 100, 100, "sample.txt");
+  msg ("readv() split the file across the buffers");
+
+  CHECK (read (handle, &c, 1) == 0, "read at end of file");
+  CHECK (readv (handle, iov, 3) == 0, "readv() at end of file");
+}
@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(readv-short) begin
+(readv-short) open "sample.txt"
+(readv-short) readv() split the file across the buffers
+(readv-short) read at end of file
+(readv-short) readv() at end of file
+(readv-short) end
+readv-short: exit(0)
+EOF
+pass;
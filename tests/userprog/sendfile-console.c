@@ -0,0 +1,20 @@
+/* Copies the first line of "sample.txt" to the console with
+   sendfile(). */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  int handle, line_len;
+
+  CHECK ((handle = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  line_len = strchr (sample, '\n') - sample + 1;
+  if (sendfile (1, handle, NULL, line_len) != line_len)
+    fail ("sendfile to the console failed");
+  CHECK (tell (handle) == (unsigned) line_len, "input position is after the line");
+}
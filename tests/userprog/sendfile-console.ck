@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(sendfile-console) begin
+(sendfile-console) open "sample.txt"
+"KAIST is the first and top science and technology university in Korea.
+(sendfile-console) input position is after the line
+(sendfile-console) end
+sendfile-console: exit(0)
+EOF
+pass;
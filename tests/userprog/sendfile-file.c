@@ -0,0 +1,28 @@
+/* Copies "sample.txt" to a new file with sendfile(), starting at each
+   file's position, and checks that both positions move. */
+
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  size_t size = sizeof sample - 1;
+  int in, out;
+
+  CHECK ((in = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  CHECK (create ("test.txt", size), "create \"test.txt\"");
+  CHECK ((out = open ("test.txt")) > 1, "open \"test.txt\"");
+
+  CHECK (sendfile (out, in, NULL, 100) == 100, "sendfile 100 bytes");
+  CHECK (tell (in) == 100, "input position is 100");
+  CHECK (tell (out) == 100, "output position is 100");
+  CHECK (sendfile (out, in, NULL, 4096) == (int) size - 100,
+         "sendfile the rest of the file");
+  CHECK (sendfile (out, in, NULL, 4096) == 0, "sendfile at end of file");
+  close (out);
+
+  check_file ("test.txt", sample, size);
+}
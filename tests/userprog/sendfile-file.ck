@@ -0,0 +1,21 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(sendfile-file) begin
+(sendfile-file) open "sample.txt"
+(sendfile-file) create "test.txt"
+(sendfile-file) open "test.txt"
+(sendfile-file) sendfile 100 bytes
+(sendfile-file) input position is 100
+(sendfile-file) output position is 100
+(sendfile-file) sendfile the rest of the file
+(sendfile-file) sendfile at end of file
+(sendfile-file) open "test.txt" for verification
+(sendfile-file) verified contents of "test.txt"
+(sendfile-file) close "test.txt"
+(sendfile-file) end
+sendfile-file: exit(0)
+EOF
+pass;
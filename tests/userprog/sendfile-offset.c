@@ -0,0 +1,42 @@
+/* Copies parts of "sample.txt" with sendfile() from an explicit
+   offset, which must be advanced while the input file's position is
+   left alone, including for a copy cut short by the end of the
+   file. */
+
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  size_t size = sizeof sample - 1;
+  int in, out;
+  off_t ofs;
+
+  CHECK ((in = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  CHECK (create ("test.txt", size), "create \"test.txt\"");
+  CHECK ((out = open ("test.txt")) > 1, "open \"test.txt\"");
+
+  /* Copy the second half first, then the first half. */
+  ofs = 200;
+  seek (out, 200);
+  CHECK (sendfile (out, in, &ofs, 4096) == (int) size - 200,
+         "sendfile from offset 200, cut short at end of file");
+  CHECK (ofs == (off_t) size, "offset advanced to end of file");
+  CHECK (tell (in) == 0, "input position is still 0");
+
+  ofs = 0;
+  seek (out, 0);
+  CHECK (sendfile (out, in, &ofs, 200) == 200, "sendfile from offset 0");
+  CHECK (ofs == 200, "offset advanced to 200");
+  CHECK (tell (in) == 0, "input position is still 0");
+
+  ofs = size;
+  CHECK (sendfile (out, in, &ofs, 10) == 0, "sendfile at end of file");
+  CHECK (ofs == (off_t) size, "offset unchanged");
+  close (out);
+
+  check_file ("test.txt", sample, size);
+}
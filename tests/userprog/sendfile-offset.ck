@@ -0,0 +1,24 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(sendfile-offset) begin
+(sendfile-offset) open "sample.txt"
+(sendfile-offset) create "test.txt"
+(sendfile-offset) open "test.txt"
+(sendfile-offset) sendfile from offset 200, cut short at end of file
+(sendfile-offset) offset advanced to end of file
+(sendfile-offset) input position is still 0
+(sendfile-offset) sendfile from offset 0
+(sendfile-offset) offset advanced to 200
+(sendfile-offset) input position is still 0
+(sendfile-offset) sendfile at end of file
+(sendfile-offset) offset unchanged
+(sendfile-offset) open "test.txt" for verification
+(sendfile-offset) verified contents of "test.txt"
+(sendfile-offset) close "test.txt"
+(sendfile-offset) end
+sendfile-offset: exit(0)
+EOF
+pass;
@@ -0,0 +1,43 @@
+/* Passes invalid file descriptor actions to spawn, which must
+   return -1 for each of them. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static pid_t
+spawn_one (int type, int fd, int newfd) 
+{
+  struct spawn_action action;
+
+  action.type = type;
+  action.fd = fd;
+  action.newfd = newfd;
+  return spawn ("child-simple", &action, 1);
+}
+
+void
+test_main (void) 
+{
+  struct spawn_action actions[SPAWN_ACTIONS_MAX + 1];
+  int fd;
+  int i;
+
+  CHECK ((fd = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  close (fd);
+
+  msg ("unknown type: %d", spawn_one (42, 0, 0));
+  msg ("negative fd: %d", spawn_one (SPAWN_CLOSE, -1, 0));
+  msg ("fd too large: %d", spawn_one (SPAWN_CLOSE, 1 << 20, 0));
+  msg ("dup2 of a closed fd: %d", spawn_one (SPAWN_DUP2, fd, 0));
+
+  for (i = 0; i <= SPAWN_ACTIONS_MAX; i++)
+    {
+      actions[i].type = SPAWN_CLOSE;
+      actions[i].fd = fd;
+      actions[i].newfd = 0;
+    }
+  msg ("too many actions: %d",
+       spawn ("child-simple", actions, SPAWN_ACTIONS_MAX + 1));
+  msg ("negative action count: %d", spawn ("child-simple", actions, -1));
+}
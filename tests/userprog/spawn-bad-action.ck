@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(spawn-bad-action) begin
+(spawn-bad-action) open "sample.txt"
+(spawn-bad-action) unknown type: -1
+(spawn-bad-action) negative fd: -1
+(spawn-bad-action) fd too large: -1
+(spawn-bad-action) dup2 of a closed fd: -1
+(spawn-bad-action) too many actions: -1
+(spawn-bad-action) negative action count: -1
+(spawn-bad-action) end
+EOF
+pass;
@@ -0,0 +1,34 @@
+/* Opens "sample.txt" three times and spawns children that count
+   how many of the three descriptors they can use: first with no
+   actions, so that all of them are inherited, then with a
+   SPAWN_CLOSEFROM of the second one.  The parent's descriptors must
+   be left alone. */
+
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  struct spawn_action action;
+  char child_cmd[128];
+  int fds[3];
+  int i;
+
+  for (i = 0; i < 3; i++)
+    CHECK ((fds[i] = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  snprintf (child_cmd, sizeof child_cmd, "child-fds %d %d %d",
+            fds[0], fds[1], fds[2]);
+
+  msg ("wait(spawn()) = %d", wait (spawn (child_cmd, NULL, 0)));
+
+  action.type = SPAWN_CLOSEFROM;
+  action.fd = fds[1];
+  msg ("wait(spawn()) = %d", wait (spawn (child_cmd, &action, 1)));
+
+  for (i = 0; i < 3; i++)
+    check_file_handle (fds[i], "sample.txt", sample, sizeof sample - 1);
+}
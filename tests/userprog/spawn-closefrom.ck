@@ -0,0 +1,20 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(spawn-closefrom) begin
+(spawn-closefrom) open "sample.txt"
+(spawn-closefrom) open "sample.txt"
+(spawn-closefrom) open "sample.txt"
+child-fds: exit(3)
+(spawn-closefrom) wait(spawn()) = 3
+child-fds: exit(1)
+(spawn-closefrom) wait(spawn()) = 1
+(spawn-closefrom) verified contents of "sample.txt"
+(spawn-closefrom) verified contents of "sample.txt"
+(spawn-closefrom) verified contents of "sample.txt"
+(spawn-closefrom) end
+spawn-closefrom: exit(0)
+EOF
+pass;
@@ -0,0 +1,33 @@
+/* Spawns a child with "sample.txt" duplicated onto its standard
+   input and a new file duplicated onto its standard output.  The
+   child copies one to the other, and the parent checks the copy. */
+
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  struct spawn_action actions[2];
+  int in_fd, out_fd;
+  pid_t pid;
+
+  CHECK ((in_fd = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  CHECK (create ("copy.txt", sizeof sample - 1), "create \"copy.txt\"");
+  CHECK ((out_fd = open ("copy.txt")) > 1, "open \"copy.txt\"");
+
+  actions[0].type = SPAWN_DUP2;
+  actions[0].fd = in_fd;
+  actions[0].newfd = 0;
+  actions[1].type = SPAWN_DUP2;
+  actions[1].fd = out_fd;
+  actions[1].newfd = 1;
+  CHECK ((pid = spawn ("child-cat", actions, 2)) != PID_ERROR,
+         "spawn \"child-cat\"");
+  msg ("wait(spawn()) = %d", wait (pid));
+
+  check_file ("copy.txt", sample, sizeof sample - 1);
+  check_file_handle (in_fd, "sample.txt", sample, sizeof sample - 1);
+}
@@ -0,0 +1,20 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(spawn-dup2) begin
+(spawn-dup2) open "sample.txt"
+(spawn-dup2) create "copy.txt"
+(spawn-dup2) open "copy.txt"
+(spawn-dup2) spawn "child-cat"
+child-cat: exit(0)
+(spawn-dup2) wait(spawn()) = 0
+(spawn-dup2) open "copy.txt" for verification
+(spawn-dup2) verified contents of "copy.txt"
+(spawn-dup2) close "copy.txt"
+(spawn-dup2) verified contents of "sample.txt"
+(spawn-dup2) end
+spawn-dup2: exit(0)
+EOF
+pass;
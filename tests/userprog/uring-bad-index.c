@@ -0,0 +1,33 @@
+/* Passes rings whose indices are inconsistent, which uring_enter()
+   must reject with -1 without touching them, and an unknown
+   operation, which must complete with -1. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static struct uring ring;
+
+void
+test_main (void) 
+{
+  ring.sq_head = 5;
+  ring.sq_tail = 5 + URING_ENTRIES + 1;
+  msg ("submission queue overfull: %d", uring_enter (&ring, 1));
+  ring.sq_tail = 4;
+  msg ("submission queue behind: %d", uring_enter (&ring, 1));
+  CHECK (ring.sq_head == 5, "sq_head unchanged");
+
+  ring.sq_head = ring.sq_tail = 0;
+  ring.cq_head = 10;
+  ring.cq_tail = 10 + URING_ENTRIES + 1;
+  msg ("completion queue overfull: %d", uring_enter (&ring, 1));
+
+  ring.cq_head = ring.cq_tail = 0;
+  ring.sqes[0].opcode = 1000;
+  ring.sqes[0].user_data = 42;
+  ring.sq_tail = 1;
+  CHECK (uring_enter (&ring, 1) == 1, "submit an unknown operation");
+  CHECK (ring.cqes[0].user_data == 42 && ring.cqes[0].res == -1,
+         "unknown operation completed with -1");
+}
@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(uring-bad-index) begin
+(uring-bad-index) submission queue overfull: -1
+(uring-bad-index) submission queue behind: -1
+(uring-bad-index) sq_head unchanged
+(uring-bad-index) completion queue overfull: -1
+(uring-bad-index) submit an unknown operation
+(uring-bad-index) unknown operation completed with -1
+(uring-bad-index) end
+uring-bad-index: exit(0)
+EOF
+pass;
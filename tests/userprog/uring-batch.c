@@ -0,0 +1,77 @@
+/* Opens, reads, writes and closes files through the submission ring,
+   several operations per uring_enter() call, and checks every
+   completion. */
+
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static struct uring ring;
+
+/* Queues one submission on RING. */
+static void
+queue (uint32_t opcode, int fd, const void *addr, uint32_t len, int64_t off,
+       uint64_t user_data) 
+{
+  struct uring_sqe *sqe = &ring.sqes[ring.sq_tail % URING_ENTRIES];
+
+  sqe->opcode = opcode;
+  sqe->fd = fd;
+  sqe->addr = (uint64_t) addr;
+  sqe->len = len;
+  sqe->off = off;
+  sqe->user_data = user_data;
+  ring.sq_tail++;
+}
+
+/* Consumes the next completion on RING, which must be for USER_DATA,
+   and returns its result. */
+static int64_t
+reap (uint64_t user_data) 
+{
+  struct uring_cqe *cqe;
+
+  if (ring.cq_head == ring.cq_tail)
+    fail ("no completion for %llu", user_data);
+  cqe = &ring.cqes[ring.cq_head++ % URING_ENTRIES];
+  if (cqe->user_data != user_data)
+    fail ("completion for %llu instead of %llu", cqe->user_data, user_data);
+  return cqe->res;
+}
+
+void
+test_main (void) 
+{
+  char buf[2][50];
+  int in, out;
+
+  CHECK (create ("test.txt", 64), "create \"test.txt\"");
+
+  queue (URING_OP_OPEN, 0, "sample.txt", 0, -1, 1);
+  queue (URING_OP_OPEN, 0, "test.txt", 0, -1, 2);
+  queue (URING_OP_NOP, 0, NULL, 0, -1, 3);
+  CHECK (uring_enter (&ring, 3) == 3, "submit two opens and a nop");
+  CHECK ((in = reap (1)) > 1, "open \"sample.txt\"");
+  CHECK ((out = reap (2)) > 1, "open \"test.txt\"");
+  CHECK (reap (3) == 0, "nop");
+
+  queue (URING_OP_READ, in, buf[0], sizeof buf[0], -1, 4);
+  queue (URING_OP_READ, in, buf[1], sizeof buf[1], 100, 5);
+  queue (URING_OP_WRITE, out, sample, 64, 0, 6);
+  queue (URING_OP_CLOSE, in, NULL, 0, -1, 7);
+  queue (URING_OP_CLOSE, out, NULL, 0, -1, 8);
+  CHECK (uring_enter (&ring, URING_ENTRIES) == 5,
+         "submit two reads, a write and two closes");
+  CHECK (reap (4) == sizeof buf[0], "read at the file position");
+  compare_bytes (buf[0], sample, sizeof buf[0], 0, "sample.txt");
+  CHECK (reap (5) == sizeof buf[1], "read at offset 100");
+  compare_bytes (buf[1], sample + 100, sizeof buf[1], 100, "sample.txt");
+  CHECK (reap (6) == 64, "write at offset 0");
+  CHECK (reap (7) == 0, "close \"sample.txt\"");
+  CHECK (reap (8) == 0, "close \"test.txt\"");
+  CHECK (ring.sq_head == ring.sq_tail, "submission queue is empty");
+  CHECK (filesize (in) == -1, "\"sample.txt\" is closed");
+
+  check_file ("test.txt", sample, 64);
+}
@@ -0,0 +1,26 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(uring-batch) begin
+(uring-batch) create "test.txt"
+(uring-batch) submit two opens and a nop
+(uring-batch) open "sample.txt"
+(uring-batch) open "test.txt"
+(uring-batch) nop
+(uring-batch) submit two reads, a write and two closes
+(uring-batch) read at the file position
+(uring-batch) read at offset 100
+(uring-batch) write at offset 0
+(uring-batch) close "sample.txt"
+(uring-batch) close "test.txt"
+(uring-batch) submission queue is empty
+(uring-batch) "sample.txt" is closed
+(uring-batch) open "test.txt" for verification
+(uring-batch) verified contents of "test.txt"
+(uring-batch) close "test.txt"
+(uring-batch) end
+uring-batch: exit(0)
+EOF
+pass;
@@ -0,0 +1,45 @@
+/* Submits more entries than the completion queue has room for.
+   uring_enter() must stop when the completion queue is full and
+   leave the rest queued for the next call. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static struct uring ring;
+
+/* Queues CNT no-op submissions on RING. */
+static void
+queue_nops (int cnt) 
+{
+  while (cnt-- > 0)
+    {
+      struct uring_sqe *sqe = &ring.sqes[ring.sq_tail % URING_ENTRIES];
+
+      sqe->opcode = URING_OP_NOP;
+      sqe->user_data = ring.sq_tail;
+      ring.sq_tail++;
+    }
+}
+
+void
+test_main (void) 
+{
+  queue_nops (URING_ENTRIES - 2);
+  CHECK (uring_enter (&ring, URING_ENTRIES) == URING_ENTRIES - 2,
+         "submit URING_ENTRIES - 2 nops");
+
+  /* Only two completion slots are left. */
+  queue_nops (4);
+  CHECK (uring_enter (&ring, URING_ENTRIES) == 2,
+         "submit 4 nops with room for 2 completions");
+  CHECK (ring.sq_tail - ring.sq_head == 2, "2 submissions still queued");
+  CHECK (uring_enter (&ring, URING_ENTRIES) == 0,
+         "submit with a full completion queue");
+
+  ring.cq_head = ring.cq_tail;
+  CHECK (uring_enter (&ring, URING_ENTRIES) == 2,
+         "submit the rest after reaping");
+  CHECK (ring.cqes[(ring.cq_tail - 1) % URING_ENTRIES].user_data
+         == URING_ENTRIES + 1, "last completion is for the last nop");
+}
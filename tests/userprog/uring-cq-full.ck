@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(uring-cq-full) begin
+(uring-cq-full) submit URING_ENTRIES - 2 nops
+(uring-cq-full) submit 4 nops with room for 2 completions
+(uring-cq-full) 2 submissions still queued
+(uring-cq-full) submit with a full completion queue
+(uring-cq-full) submit the rest after reaping
+(uring-cq-full) last completion is for the last nop
+(uring-cq-full) end
+uring-cq-full: exit(0)
+EOF
+pass;
@@ -0,0 +1,33 @@
+/* Writes the sample text to a new file with writev(), in three
+   pieces, then appends with write() to check the file position. */
+
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  struct iovec iov[3];
+  size_t size = sizeof sample - 1;
+  int handle, byte_cnt;
+
+  CHECK (create ("test.txt", size), "create \"test.txt\"");
+  CHECK ((handle = open ("test.txt")) > 1, "open \"test.txt\"");
+
+  iov[0].iov_base = sample;
+  iov[0].iov_len = 10;
+  iov[1].iov_base = sample + 10;
+  iov[1].iov_len = 200;
+  iov[2].iov_base = sample + 210;
+  iov[2].iov_len = size - 220;
+  byte_cnt = writev (handle, iov, 3);
+  if (byte_cnt != (int) size - 10)
+    fail ("writev() returned %d instead of %zu", byte_cnt, size - 10);
+  CHECK (write (handle, sample + size - 10, 10) == 10,
+         "write the last 10 bytes");
+  close (handle);
+
+  check_file ("test.txt", sample, size);
+}
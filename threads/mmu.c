@@ -6,16 +6,90 @@
 #include "threads/palloc.h"
 #include "threads/thread.h"
 #include "threads/mmu.h"
+#include "threads/interrupt.h"
+#include "threads/synch.h"
 #include "intrinsic.h"
 
+/* Cache of zeroed page-table pages.
+ * Freed table pages are zeroed by whoever frees them (normally the
+ * reaper thread below) and kept here, so that walking into a new part of
+ * an address space does not have to go through the page allocator and
+ * zero a page on the faulting path.  A free page holds its list_elem in
+ * its first bytes, which are cleared again when it is handed out. */
+#define PT_CACHE_MAX 64
+
+static struct list pt_cache;
+static size_t pt_cache_cnt;
+
+/* Page tables of exited processes waiting to be torn down by the reaper
+ * thread.  A queued pml4 keeps its list_elem in its last two entries,
+ * which map kernel space and are no longer needed. */
+static struct list reap_list;
+static struct semaphore reap_sema;
+static bool reaper_started;
+
+#define reap_elem(pml4) \
+	((struct list_elem *) &(pml4)[PGSIZE / sizeof (uint64_t) - 2])
+
+/* Process-context identifiers.
+ * With CR4.PCIDE set, TLB entries are tagged with the PCID held in the
+ * low 12 bits of CR3, so switching address spaces no longer has to flush
+ * the whole TLB.  PCID 0 belongs to base_pml4.  Every other pml4 is
+ * hashed onto one of the remaining PCIDs by its physical page number; the
+ * slot remembers which pml4 last used it.  A pml4 whose slot was taken by
+ * another one, or whose entries were changed while it was not active,
+ * gets its PCID flushed on its next activation. */
+#define PCID_CNT 4096
+#define CR4_PCIDE (1 << 17)            /* PCID enable. */
+#define CPUID_PCID (1 << 17)           /* CPUID.01H:ECX PCID support. */
+#define CR3_NOFLUSH (1UL << 63)        /* Keep TLB entries of the PCID. */
+
+static bool pcid_enabled;
+static uint64_t *pcid_owner[PCID_CNT];
+
+#define pcid_of(pml4) (1 + pg_no (vtop (pml4)) % (PCID_CNT - 1))
+
+/* Returns true if PML4 is the page table the CPU is using. */
+static inline bool
+pml4_is_active (uint64_t *pml4) {
+	return PTE_ADDR (rcr3 ()) == vtop (pml4);
+}
+
+static void *pt_alloc (void);
+static void pt_free (void *page);
+static void pml4_reaper (void *aux UNUSED);
+static void pml4_destroy_now (uint64_t *pml4);
+static void pml4_free_frames (uint64_t *pml4);
+
+/* Replaces the 2 MiB mapping in PDE by a page table of 512 4 kB
+ * mappings of the same frames with the same permissions, so that a
+ * single page of it can be changed.  Returns false if memory
+ * allocation fails. */
+static bool
+pde_split (uint64_t *pde) {
+	uint64_t *pt = pt_alloc ();
+	uint64_t base = PTE_ADDR (*pde);
+	uint64_t flags = *pde & PTE_FLAGS & ~PTE_PS;
+
+	if (pt == NULL)
+		return false;
+	for (unsigned i = 0; i < PGSIZE / sizeof(uint64_t *); i++)
+		pt[i] = (base + i * PGSIZE) | flags;
+	*pde = vtop (pt) | PTE_U | PTE_W | PTE_P;
+	return true;
+}
+
 static uint64_t *
 pgdir_walk (uint64_t *pdp, const uint64_t va, int create) {
 	int idx = PDX (va);
 	if (pdp) {
 		uint64_t *pte = (uint64_t *) pdp[idx];
+		if (((uint64_t) pte & PTE_P) && ((uint64_t) pte & PTE_PS)
+				&& !pde_split (&pdp[idx]))
+			return NULL;
 		if (!((uint64_t) pte & PTE_P)) {
 			if (create) {
-				uint64_t *new_page = palloc_get_page (PAL_ZERO);
+				uint64_t *new_page = pt_alloc ();
 				if (new_page)
 					pdp[idx] = vtop (new_page) | PTE_U | PTE_W | PTE_P;
 				else
@@ -37,7 +111,7 @@ pdpe_walk (uint64_t *pdpe, const uint64_t va, int create) {
 		uint64_t *pde = (uint64_t *) pdpe[idx];
 		if (!((uint64_t) pde & PTE_P)) {
 			if (create) {
-				uint64_t *new_page = palloc_get_page (PAL_ZERO);
+				uint64_t *new_page = pt_alloc ();
 				if (new_page) {
 					pdpe[idx] = vtop (new_page) | PTE_U | PTE_W | PTE_P;
 					allocated = 1;
@@ -49,7 +123,7 @@ pdpe_walk (uint64_t *pdpe, const uint64_t va, int create) {
 		pte = pgdir_walk (ptov (PTE_ADDR (pdpe[idx])), va, create);
 	}
 	if (pte == NULL && allocated) {
-		palloc_free_page ((void *) ptov (PTE_ADDR (pdpe[idx])));
+		pt_free ((void *) ptov (PTE_ADDR (pdpe[idx])));
 		pdpe[idx] = 0;
 	}
 	return pte;
@@ -70,7 +144,7 @@ pml4e_walk (uint64_t *pml4e, const uint64_t va, int create) {
 		uint64_t *pdpe = (uint64_t *) pml4e[idx];
 		if (!((uint64_t) pdpe & PTE_P)) {
 			if (create) {
-				uint64_t *new_page = palloc_get_page (PAL_ZERO);
+				uint64_t *new_page = pt_alloc ();
 				if (new_page) {
 					pml4e[idx] = vtop (new_page) | PTE_U | PTE_W | PTE_P;
 					allocated = 1;
@@ -82,19 +156,40 @@ pml4e_walk (uint64_t *pml4e, const uint64_t va, int create) {
 		pte = pdpe_walk (ptov (PTE_ADDR (pml4e[idx])), va, create);
 	}
 	if (pte == NULL && allocated) {
-		palloc_free_page ((void *) ptov (PTE_ADDR (pml4e[idx])));
+		pt_free ((void *) ptov (PTE_ADDR (pml4e[idx])));
 		pml4e[idx] = 0;
 	}
 	return pte;
 }
 
+/* Returns the address of the page directory entry for virtual
+ * address VA in PML4, creating the upper levels if CREATE is true.
+ * Used to install and look up 2 MiB mappings. */
+uint64_t *
+pml4e_walk_huge (uint64_t *pml4, const uint64_t va, int create) {
+	uint64_t *table = pml4;
+	uint64_t shift;
+
+	for (shift = PML4SHIFT; shift > PDXSHIFT; shift -= 9) {
+		uint64_t *entry = &table[(va >> shift) & 0x1FF];
+		if (!(*entry & PTE_P)) {
+			uint64_t *new_page;
+			if (!create || (new_page = pt_alloc ()) == NULL)
+				return NULL;
+			*entry = vtop (new_page) | PTE_U | PTE_W | PTE_P;
+		}
+		table = ptov (PTE_ADDR (*entry));
+	}
+	return &table[PDX (va)];
+}
+
 /* Creates a new page map level 4 (pml4) has mappings for kernel
  * virtual addresses, but none for user virtual addresses.
  * Returns the new page directory, or a null pointer if memory
  * allocation fails. */
 uint64_t *
 pml4_create (void) {
-	uint64_t *pml4 = palloc_get_page (0);
+	uint64_t *pml4 = pt_alloc ();
 	if (pml4)
 		memcpy (pml4, base_pml4, PGSIZE);
 	return pml4;
@@ -122,7 +217,14 @@ pgdir_for_each (uint64_t *pdp, pte_for_each_func *func, void *aux,
 		unsigned pml4_index, unsigned pdp_index) {
 	for (unsigned i = 0; i < PGSIZE / sizeof(uint64_t *); i++) {
 		uint64_t *pte = ptov((uint64_t *) pdp[i]);
-		if (((uint64_t) pte) & PTE_P)
+		if (((uint64_t) pte) & PTE_P && ((uint64_t) pte) & PTE_PS) {
+			/* 2 MiB mapping: FUNC gets the PDE itself. */
+			void *va = (void *) (((uint64_t) pml4_index << PML4SHIFT) |
+								 ((uint64_t) pdp_index << PDPESHIFT) |
+								 ((uint64_t) i << PDXSHIFT));
+			if (!func (&pdp[i], va, aux))
+				return false;
+		} else if (((uint64_t) pte) & PTE_P)
 			if (!pt_for_each ((uint64_t *) PTE_ADDR (pte), func, aux,
 					pml4_index, pdp_index, i))
 				return false;
@@ -162,17 +264,19 @@ pt_destroy (uint64_t *pt) {
 		if (((uint64_t) pte) & PTE_P)
 			palloc_free_page ((void *) PTE_ADDR (pte));
 	}
-	palloc_free_page ((void *) pt);
+	pt_free ((void *) pt);
 }
 
 static void
 pgdir_destroy (uint64_t *pdp) {
 	for (unsigned i = 0; i < PGSIZE / sizeof(uint64_t *); i++) {
 		uint64_t *pte = ptov((uint64_t *) pdp[i]);
-		if (((uint64_t) pte) & PTE_P)
+		if (((uint64_t) pte) & PTE_P && ((uint64_t) pte) & PTE_PS)
+			palloc_free_multiple ((void *) PTE_ADDR (pte), LPGSIZE / PGSIZE);
+		else if (((uint64_t) pte) & PTE_P)
 			pt_destroy (PTE_ADDR (pte));
 	}
-	palloc_free_page ((void *) pdp);
+	pt_free ((void *) pdp);
 }
 
 static void
@@ -182,28 +286,202 @@ pdpe_destroy (uint64_t *pdpe) {
 		if (((uint64_t) pde) & PTE_P)
 			pgdir_destroy ((void *) PTE_ADDR (pde));
 	}
-	palloc_free_page ((void *) pdpe);
+	pt_free ((void *) pdpe);
 }
 
-/* Destroys pml4e, freeing all the pages it references. */
+/* Destroys pml4e, freeing all the pages it references.
+ * PML4 must no longer be active.  The frames it maps are freed right
+ * away, so that they are available to the next allocation; only the page
+ * tables themselves are left to the reaper thread. */
 void
 pml4_destroy (uint64_t *pml4) {
+	enum intr_level old_level;
+
 	if (pml4 == NULL)
 		return;
 	ASSERT (pml4 != base_pml4);
 
+	if (!reaper_started) {
+		pml4_destroy_now (pml4);
+		return;
+	}
+
+	pml4_free_frames (pml4);
+	old_level = intr_disable ();
+	list_push_back (&reap_list, reap_elem (pml4));
+	intr_set_level (old_level);
+	sema_up (&reap_sema);
+}
+
+/* Initializes the cache of page-table pages.  Must be called before
+ * the first page table is created. */
+void
+pml4_cache_init (void) {
+	list_init (&pt_cache);
+}
+
+/* Starts the thread that tears down the page tables of exited
+ * processes. */
+void
+pml4_reaper_init (void) {
+	list_init (&reap_list);
+	sema_init (&reap_sema, 0);
+	if (thread_create ("pt_reaper", PRI_DEFAULT, pml4_reaper, NULL)
+			!= TID_ERROR)
+		reaper_started = true;
+}
+
+static void
+pml4_reaper (void *aux UNUSED) {
+	for (;;) {
+		enum intr_level old_level;
+		struct list_elem *e;
+
+		sema_down (&reap_sema);
+		old_level = intr_disable ();
+		e = list_pop_front (&reap_list);
+		intr_set_level (old_level);
+
+		pml4_destroy_now ((uint64_t *) pg_round_down (e));
+	}
+}
+
+/* Frees the frames mapped by PML4 and clears their entries, leaving the
+ * page tables for pml4_destroy_now(). */
+static void
+pml4_free_frames (uint64_t *pml4) {
+	uint64_t *pdpe, *pgdir, *pt;
+
+	if (!(pml4[0] & PTE_P))
+		return;
+	pdpe = ptov (PTE_ADDR (pml4[0]));
+	for (unsigned i = 0; i < PGSIZE / sizeof (uint64_t); i++) {
+		if (!(pdpe[i] & PTE_P))
+			continue;
+		pgdir = ptov (PTE_ADDR (pdpe[i]));
+		for (unsigned j = 0; j < PGSIZE / sizeof (uint64_t); j++) {
+			if (!(pgdir[j] & PTE_P))
+				continue;
+			if (pgdir[j] & PTE_PS) {
+				palloc_free_multiple (ptov (PTE_ADDR (pgdir[j])),
+						LPGSIZE / PGSIZE);
+				pgdir[j] = 0;
+				continue;
+			}
+			pt = ptov (PTE_ADDR (pgdir[j]));
+			for (unsigned k = 0; k < PGSIZE / sizeof (uint64_t); k++)
+				if (pt[k] & PTE_P) {
+					palloc_free_page (ptov (PTE_ADDR (pt[k])));
+					pt[k] = 0;
+				}
+		}
+	}
+}
+
+static void
+pml4_destroy_now (uint64_t *pml4) {
+	/* A new pml4 on the same page must not inherit our TLB entries. */
+	if (pcid_enabled && pcid_owner[pcid_of (pml4)] == pml4)
+		pcid_owner[pcid_of (pml4)] = NULL;
+
 	/* if PML4 (vaddr) >= 1, it's kernel space by define. */
 	uint64_t *pdpe = ptov ((uint64_t *) pml4[0]);
 	if (((uint64_t) pdpe) & PTE_P)
 		pdpe_destroy ((void *) PTE_ADDR (pdpe));
-	palloc_free_page ((void *) pml4);
+	pt_free ((void *) pml4);
+}
+
+/* Returns a zeroed page for a page table, preferably from the cache. */
+static void *
+pt_alloc (void) {
+	enum intr_level old_level;
+	void *page = NULL;
+
+	old_level = intr_disable ();
+	if (pt_cache_cnt > 0) {
+		page = list_pop_front (&pt_cache);
+		pt_cache_cnt--;
+	}
+	intr_set_level (old_level);
+
+	if (page == NULL)
+		return palloc_get_page (PAL_ZERO);
+	memset (page, 0, sizeof (struct list_elem));
+	return page;
+}
+
+/* Zeroes PAGE and keeps it in the cache, or gives it back to the page
+ * allocator if the cache is full. */
+static void
+pt_free (void *page) {
+	enum intr_level old_level;
+
+	memset (page, 0, PGSIZE);
+	old_level = intr_disable ();
+	if (pt_cache_cnt < PT_CACHE_MAX) {
+		list_push_front (&pt_cache, (struct list_elem *) page);
+		pt_cache_cnt++;
+		page = NULL;
+	}
+	intr_set_level (old_level);
+
+	if (page != NULL)
+		palloc_free_page (page);
+}
+
+/* Turns on PCIDs if the CPU supports them.  Must be called while
+ * base_pml4 is active, as CR3 may not carry a PCID when PCIDE is set. */
+void
+pml4_pcid_init (void) {
+	uint32_t eax, ebx, ecx, edx;
+
+	cpuid (1, &eax, &ebx, &ecx, &edx);
+	if (!(ecx & CPUID_PCID))
+		return;
+
+	lcr3 (vtop (base_pml4));
+	lcr4 (rcr4 () | CR4_PCIDE);
+	pcid_enabled = true;
 }
 
 /* Loads page directory PD into the CPU's page directory base
- * register. */
+ * register.  Reloading the table that is already active is skipped,
+ * and with PCIDs only a stale PCID is flushed. */
 void
 pml4_activate (uint64_t *pml4) {
-	lcr3 (vtop (pml4 ? pml4 : base_pml4));
+	uint64_t *target = pml4 ? pml4 : base_pml4;
+	uint64_t pcid;
+
+	if (!pcid_enabled) {
+		if (!pml4_is_active (target))
+			lcr3 (vtop (target));
+		return;
+	}
+
+	if (target == base_pml4) {
+		/* base_pml4 maps nothing but the kernel, which never changes. */
+		lcr3 (vtop (base_pml4) | CR3_NOFLUSH);
+		return;
+	}
+
+	pcid = pcid_of (target);
+	if (pcid_owner[pcid] == target)
+		lcr3 (vtop (target) | pcid | CR3_NOFLUSH);
+	else {
+		pcid_owner[pcid] = target;
+		lcr3 (vtop (target) | pcid);
+	}
+}
+
+/* Drops any TLB entry for VA in PML4 after its PTE has changed.
+ * The active table gets an invlpg; any other one loses its PCID
+ * entries on its next activation. */
+void
+pml4_invalidate_page (uint64_t *pml4, const void *va) {
+	if (pml4_is_active (pml4))
+		invlpg ((uint64_t) va);
+	else if (pcid_enabled && pcid_owner[pcid_of (pml4)] == pml4)
+		pcid_owner[pcid_of (pml4)] = NULL;
 }
 
 /* Looks up the physical address that corresponds to user virtual
@@ -214,6 +492,10 @@ void *
 pml4_get_page (uint64_t *pml4, const void *uaddr) {
 	ASSERT (is_user_vaddr (uaddr));
 
+	uint64_t *pde = pml4e_walk_huge (pml4, (uint64_t) uaddr, 0);
+	if (pde && (*pde & PTE_P) && (*pde & PTE_PS))
+		return ptov (PTE_ADDR (*pde)) + lpg_ofs (uaddr);
+
 	uint64_t *pte = pml4e_walk (pml4, (uint64_t) uaddr, 0);
 
 	if (pte && (*pte & PTE_P))
@@ -257,8 +539,7 @@ pml4_clear_page (uint64_t *pml4, void *upage) {
 
 	if (pte != NULL && (*pte & PTE_P) != 0) {
 		*pte &= ~PTE_P;
-		if (rcr3 () == vtop (pml4))
-			invlpg ((uint64_t) upage);
+		pml4_invalidate_page (pml4, upage);
 	}
 }
 
@@ -283,8 +564,7 @@ pml4_set_dirty (uint64_t *pml4, const void *vpage, bool dirty) {
 		else
 			*pte &= ~(uint32_t) PTE_D;
 
-		if (rcr3 () == vtop (pml4))
-			invlpg ((uint64_t) vpage);
+		pml4_invalidate_page (pml4, vpage);
 	}
 }
 
@@ -309,7 +589,6 @@ pml4_set_accessed (uint64_t *pml4, const void *vpage, bool accessed) {
 		else
 			*pte &= ~(uint32_t) PTE_A;
 
-		if (rcr3 () == vtop (pml4))
-			invlpg ((uint64_t) vpage);
+		pml4_invalidate_page (pml4, vpage);
 	}
 }
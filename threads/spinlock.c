@@ -0,0 +1,122 @@
+#include "threads/spinlock.h"
+#include <debug.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include "intrinsic.h"
+
+/* Locks registered with a name, in registration order. */
+static struct list named_locks;
+
+/* Initializes the list of named locks.  Must be called before the
+   first lock is initialized. */
+void
+lock_stats_init (void) {
+	list_init (&named_locks);
+}
+
+/* Gives STATS a NAME and adds it to the list printed by
+   lock_print_stats().  A null NAME leaves STATS unregistered. */
+void
+lock_stats_register (struct lock_stats *stats, const char *name) {
+	enum intr_level old_level;
+
+	stats->name = name;
+	if (name == NULL)
+		return;
+
+	old_level = intr_disable ();
+	list_push_back (&named_locks, &stats->elem);
+	intr_set_level (old_level);
+}
+
+/* Records an acquire of the lock that owns STATS.  CONTENDED is true
+   if the acquirer had to wait. */
+void
+lock_stats_acquired (struct lock_stats *stats, bool contended) {
+	stats->acquires++;
+	if (contended)
+		stats->contended++;
+	stats->hold_start = rdtsc ();
+}
+
+/* Records a release of the lock that owns STATS. */
+void
+lock_stats_released (struct lock_stats *stats) {
+	uint64_t hold = rdtsc () - stats->hold_start;
+
+	if (hold > stats->max_hold)
+		stats->max_hold = hold;
+}
+
+/* Prints the statistics of every named lock. */
+void
+lock_print_stats (void) {
+	struct list_elem *e;
+
+	if (list_empty (&named_locks))
+		return;
+
+	printf ("Locks: %-16s %12s %12s %14s\n",
+			"name", "acquires", "contended", "max hold (cyc)");
+	for (e = list_begin (&named_locks); e != list_end (&named_locks);
+			e = list_next (e)) {
+		struct lock_stats *s = list_entry (e, struct lock_stats, elem);
+		printf ("       %-16s %12"PRIu64" %12"PRIu64" %14"PRIu64"\n",
+				s->name, s->acquires, s->contended, s->max_hold);
+	}
+}
+
+/* Initializes SL as an unlocked spinlock.  If NAME is not null,
+   SL's statistics are printed at shutdown under that name. */
+void
+spinlock_init (struct spinlock *sl, const char *name) {
+	ASSERT (sl != NULL);
+
+	sl->next_ticket = 0;
+	sl->now_serving = 0;
+	sl->stats = (struct lock_stats) { 0 };
+	lock_stats_register (&sl->stats, name);
+}
+
+/* Disables interrupts and acquires SL, spinning until our ticket
+   comes up.  SL must not already be held by this CPU. */
+void
+spinlock_acquire (struct spinlock *sl) {
+	enum intr_level old_level;
+	unsigned ticket;
+	bool contended = false;
+
+	ASSERT (sl != NULL);
+
+	old_level = intr_disable ();
+	ticket = __atomic_fetch_add (&sl->next_ticket, 1, __ATOMIC_RELAXED);
+	while (__atomic_load_n (&sl->now_serving, __ATOMIC_ACQUIRE) != ticket) {
+		contended = true;
+		asm volatile ("pause");
+	}
+
+	sl->old_level = old_level;
+	lock_stats_acquired (&sl->stats, contended);
+}
+
+/* Releases SL and restores the interrupt level from before
+   spinlock_acquire(). */
+void
+spinlock_release (struct spinlock *sl) {
+	enum intr_level old_level;
+
+	ASSERT (sl != NULL);
+	ASSERT (spinlock_is_locked (sl));
+
+	old_level = sl->old_level;
+	lock_stats_released (&sl->stats);
+	__atomic_store_n (&sl->now_serving, sl->now_serving + 1, __ATOMIC_RELEASE);
+	intr_set_level (old_level);
+}
+
+/* Returns true if some CPU holds SL. */
+bool
+spinlock_is_locked (const struct spinlock *sl) {
+	return __atomic_load_n (&sl->now_serving, __ATOMIC_RELAXED)
+		!= __atomic_load_n (&sl->next_ticket, __ATOMIC_RELAXED);
+}
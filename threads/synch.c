@@ -32,8 +32,13 @@
 #include "threads/interrupt.h"
 #include "threads/thread.h"
 
-bool cmp_sema(const struct list_elem *a_, const struct list_elem *b_, void *aux UNUSED);
-void donate_priority(void);
+static bool sema_elem_less (const struct list_elem *a_,
+		const struct list_elem *b_, void *aux UNUSED);
+static struct thread *sema_handoff (struct semaphore *);
+static void donor_add (struct thread *holder, struct thread *donor);
+static void donor_remove (struct thread *holder, struct thread *donor);
+static bool refresh_priority (struct thread *);
+static void donate_priority (struct thread *);
 /* Initializes semaphore SEMA to VALUE.  A semaphore is a
    nonnegative integer along with two atomic operators for
    manipulating it:
@@ -58,21 +63,30 @@ sema_init (struct semaphore *sema, unsigned value) {
    interrupt handler.  This function may be called with
    interrupts disabled, but if it sleeps then the next scheduled
    thread will probably turn interrupts back on. This is
-   sema_down function. */
+   sema_down function.
+
+   Waiters are kept in priority order as they are added, and
+   thread_update_priority() moves a waiter whose priority changes,
+   so sema_up() can simply take the first one. */
 void
 sema_down (struct semaphore *sema) {
+	struct thread *cur = thread_current ();
 	enum intr_level old_level;
 
 	ASSERT (sema != NULL);
 	ASSERT (!intr_context ());
 
 	old_level = intr_disable ();
-	while (sema->value == 0) {
-		//list_push_back (&sema->waiters, &thread_current ()->elem);
-		list_insert_ordered(&sema->waiters, &thread_current ()->elem, cmp_priority, NULL);
+	if (sema->value == 0) {
+		list_insert_ordered(&sema->waiters, &cur->elem, cmp_priority, NULL);
+		cur->wait_list = &sema->waiters;
 		thread_block ();
-	}
-	sema->value--;
+
+		/* sema_up() gave its unit straight to us. */
+		ASSERT (cur->sema_handoff);
+		cur->sema_handoff = false;
+	} else
+		sema->value--;
 	intr_set_level (old_level);
 }
 
@@ -112,16 +126,35 @@ sema_up (struct semaphore *sema) {
 	ASSERT (sema != NULL);
 
 	old_level = intr_disable ();
-	if (!list_empty (&sema->waiters)){
-		list_sort(&sema->waiters, cmp_priority, NULL);
-		thread_unblock (list_entry (list_pop_front (&sema->waiters),
-					struct thread, elem));
-	}
-	sema->value++;
+	sema_handoff (sema);
 	thread_change_by_priority();
 	intr_set_level (old_level);
 }
 
+/* Hands SEMA's new unit directly to its highest-priority waiter
+   and returns that thread, or increments SEMA's value and returns a
+   null pointer if nobody is waiting.  Handing the unit over, rather
+   than letting the woken thread retry the down, means a thread
+   running in the meantime cannot take it and send the waiter back
+   to sleep.  Interrupts must be off. */
+static struct thread *
+sema_handoff (struct semaphore *sema) {
+	struct thread *t;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	if (list_empty (&sema->waiters)) {
+		sema->value++;
+		return NULL;
+	}
+
+	t = list_entry (list_pop_front (&sema->waiters), struct thread, elem);
+	t->wait_list = NULL;
+	t->sema_handoff = true;
+	thread_unblock (t);
+	return t;
+}
+
 static void sema_test_helper (void *sema_);
 
 /* Self-test for semaphores that makes control "ping-pong"
@@ -178,6 +211,16 @@ lock_init (struct lock *lock) {
 
 	lock->holder = NULL;
 	sema_init (&lock->semaphore, 1);
+	lock->stats = (struct lock_stats) { 0 };
+}
+
+/* Names LOCK so that its contention statistics are printed at
+   shutdown.  NAME must stay valid for as long as LOCK exists. */
+void
+lock_set_name (struct lock *lock, const char *name) {
+	ASSERT (lock != NULL);
+
+	lock_stats_register (&lock->stats, name);
 }
 
 /* Acquires LOCK, sleeping until it becomes available if
@@ -193,22 +236,31 @@ lock_acquire (struct lock *lock) {
 	ASSERT (lock != NULL);
 	ASSERT (!intr_context ());
 	ASSERT (!lock_held_by_current_thread (lock));
+	bool contended = lock->semaphore.value == 0;
+	int64_t wait_start = timer_ticks ();
 	if(thread_mlfqs){
 		sema_down (&lock->semaphore);
 		lock->holder = thread_current ();	
 	} else {
+		/* Interrupts stay off until we are on the semaphore's wait
+		   list, so the holder cannot release the lock while we are
+		   in its donor heap but not yet waiting. */
+		enum intr_level old_level = intr_disable ();
 		if(lock->holder != NULL){
 			struct thread *now_thread = thread_current();
 			now_thread->wait_on_lock = lock;
-			list_insert_ordered(&(lock->holder->donations), &now_thread->d_elem, cmp_doner_priority, NULL);
-
-			donate_priority();
+			donor_add(lock->holder, now_thread);
+			donate_priority(lock->holder);
 		}
 		sema_down (&lock->semaphore);
 		
-		thread_current()->wait_on_lock == NULL;
+		thread_current()->wait_on_lock = NULL;
 		lock->holder = thread_current ();
+		intr_set_level (old_level);
 	}
+	if (contended)
+		thread_current ()->stats.lock_wait_ticks += timer_ticks () - wait_start;
+	lock_stats_acquired (&lock->stats, contended);
 }
 
 /* Tries to acquires LOCK and returns true if successful or false
@@ -219,14 +271,23 @@ lock_acquire (struct lock *lock) {
    interrupt handler. */
 bool
 lock_try_acquire (struct lock *lock) {
+	enum intr_level old_level;
 	bool success;
 
 	ASSERT (lock != NULL);
 	ASSERT (!lock_held_by_current_thread (lock));
 
+	/* Set the holder before anyone can see the lock taken, as
+	   lock_acquire() does, or a waiter could go to sleep without
+	   donating to us. */
+	old_level = intr_disable ();
 	success = sema_try_down (&lock->semaphore);
 	if (success)
 		lock->holder = thread_current ();
+	intr_set_level (old_level);
+
+	if (success)
+		lock_stats_acquired (&lock->stats, false);
 	return success;
 }
 
@@ -240,32 +301,39 @@ void
 lock_release (struct lock *lock) {
 	ASSERT (lock != NULL);
 	ASSERT (lock_held_by_current_thread (lock));
+	lock_stats_released (&lock->stats);
 	//remove threads of donations
 	if(thread_mlfqs){
-		lock->holder = NULL;
-		sema_up (&lock->semaphore);
+		enum intr_level old_level = intr_disable ();
+		lock->holder = sema_handoff (&lock->semaphore);
+		thread_change_by_priority();
+		intr_set_level (old_level);
 	} else {
 		struct thread *now_thread = thread_current();
+		enum intr_level old_level = intr_disable ();
 		struct list_elem *e;
-		for (e = list_begin(&(now_thread->donations)); e != list_end (&(now_thread->donations)); e = list_next(e)){
-			struct thread *doner = list_entry(e, struct thread, d_elem);
-			if(doner->wait_on_lock == lock){
-				list_remove(&doner->d_elem);	
-			}
+
+		/* Everyone waiting on LOCK stops donating to us. */
+		for (e = list_begin (&lock->semaphore.waiters);
+				e != list_end (&lock->semaphore.waiters); e = list_next (e))
+			donor_remove (now_thread, list_entry (e, struct thread, elem));
+
+		/* Hand the lock straight to the top waiter.  The other
+		   waiters now wait on it, so they donate to it. */
+		struct thread *next = sema_handoff (&lock->semaphore);
+		lock->holder = next;
+		if (next != NULL) {
+			next->wait_on_lock = NULL;
+			for (e = list_begin (&lock->semaphore.waiters);
+					e != list_end (&lock->semaphore.waiters); e = list_next (e))
+				donor_add (next, list_entry (e, struct thread, elem));
+			refresh_priority (next);
 		}
+
 		//revert priority
-		now_thread->priority = now_thread->origin_priority;
-
-		if(!list_empty(&now_thread->donations)){
-			struct list_elem *h_elem = list_max(&now_thread->donations, cmp_doner_priority, NULL);
-			struct thread *cmp_thread = list_entry(h_elem, struct thread, d_elem);
-			if(now_thread->priority < cmp_thread->priority){
-				now_thread->priority = cmp_thread->priority;
-			}
-		}
-		
-		lock->holder = NULL;
-		sema_up (&lock->semaphore);
+		refresh_priority (now_thread);
+		thread_change_by_priority();
+		intr_set_level (old_level);
 	}
 }
 
@@ -283,6 +351,7 @@ lock_held_by_current_thread (const struct lock *lock) {
 struct semaphore_elem {
 	struct list_elem elem;              /* List element. */
 	struct semaphore semaphore;         /* This semaphore. */
+	struct thread *thread;              /* Thread waiting on it. */
 };
 
 /* Initializes condition variable COND.  A condition variable
@@ -325,8 +394,8 @@ cond_wait (struct condition *cond, struct lock *lock) {
 	ASSERT (lock_held_by_current_thread (lock));
 
 	sema_init (&waiter.semaphore, 0);
-	//list_push_back (&cond->waiters, &waiter.elem);
-	list_insert_ordered(&cond->waiters,  &waiter.elem, cmp_sema, NULL);
+	waiter.thread = thread_current ();
+	list_push_back (&cond->waiters, &waiter.elem);
 	lock_release (lock);
 	sema_down (&waiter.semaphore);
 	lock_acquire (lock);
@@ -346,10 +415,13 @@ cond_signal (struct condition *cond, struct lock *lock UNUSED) {
 	ASSERT (!intr_context ());
 	ASSERT (lock_held_by_current_thread (lock));
 
-	if (!list_empty (&cond->waiters))
-		list_sort(&cond->waiters, cmp_sema, NULL);
-		sema_up (&list_entry (list_pop_front (&cond->waiters),
-					struct semaphore_elem, elem)->semaphore);
+	/* Waiters' priorities may have changed since they started
+	   waiting, so pick the most urgent one now. */
+	if (!list_empty (&cond->waiters)) {
+		struct list_elem *e = list_max (&cond->waiters, sema_elem_less, NULL);
+		list_remove (e);
+		sema_up (&list_entry (e, struct semaphore_elem, elem)->semaphore);
+	}
 }
 
 /* Wakes up all threads, if any, waiting on COND (protected by
@@ -367,29 +439,142 @@ cond_broadcast (struct condition *cond, struct lock *lock) {
 		cond_signal (cond, lock);
 }
 
-bool
-cmp_sema(const struct list_elem *a_, const struct list_elem *b_,
-            void *aux UNUSED) 
-{
-	struct semaphore_elem *a = list_entry (a_, struct semaphore_elem, elem);
-  	struct semaphore_elem *b = list_entry (b_, struct semaphore_elem, elem);
+/* Returns true if the thread waiting on A has lower priority
+   than the one waiting on B. */
+static bool
+sema_elem_less (const struct list_elem *a_, const struct list_elem *b_,
+		void *aux UNUSED) {
+	const struct semaphore_elem *a = list_entry (a_, struct semaphore_elem, elem);
+	const struct semaphore_elem *b = list_entry (b_, struct semaphore_elem, elem);
+
+	return a->thread->priority < b->thread->priority;
+}
 
-	struct thread *aa = list_entry (list_begin(&(a->semaphore.waiters)), struct thread, elem);
-	struct thread *bb = list_entry (list_begin(&(b->semaphore.waiters)), struct thread, elem);
+/* Priority donation.
+
+   Every thread keeps the threads waiting on the locks it holds in a
+   pairing heap ordered by priority, rooted at its `donors' member;
+   its own node lives in the `donor_*' members.  A thread waits on
+   at most one lock, so it is in at most one heap.  The heap gives
+   the highest donation in O(1) and adds or removes a donor in
+   O(log n) amortized time.  Interrupts must be off for all of
+   these. */
+
+/* Melds the heaps rooted at A and B and returns the new root. */
+static struct thread *
+donor_meld (struct thread *a, struct thread *b) {
+	struct thread *t;
+
+	if (a == NULL)
+		return b;
+	if (b == NULL)
+		return a;
+	if (b->priority > a->priority) {
+		t = a;
+		a = b;
+		b = t;
+	}
 
-  	return aa->priority > bb->priority;
+	/* B becomes A's first child. */
+	b->donor_prev = a;
+	b->donor_next = a->donor_child;
+	if (a->donor_child != NULL)
+		a->donor_child->donor_prev = b;
+	a->donor_child = b;
+	return a;
 }
 
-void
-donate_priority(void){
-	struct thread *now_thread = thread_current();
-	int cnt = DONATE_DEPTH;
-	while(1){
-		if(cnt <= 0 || now_thread->wait_on_lock == NULL){
-			break;
-		}
-		now_thread->wait_on_lock->holder->priority = now_thread->priority;
-		now_thread = now_thread->wait_on_lock->holder;
-		cnt--;
+/* Melds the sibling list starting at FIRST into one heap, pairing
+   neighbours left to right and then melding the pairs right to
+   left, and returns its root. */
+static struct thread *
+donor_merge_pairs (struct thread *first) {
+	struct thread *pairs = NULL;
+	struct thread *root = NULL;
+
+	while (first != NULL) {
+		struct thread *a = first;
+		struct thread *b = a->donor_next;
+
+		first = b != NULL ? b->donor_next : NULL;
+		a->donor_prev = a->donor_next = NULL;
+		if (b != NULL)
+			b->donor_prev = b->donor_next = NULL;
+		a = donor_meld (a, b);
+		a->donor_next = pairs;
+		pairs = a;
+	}
+	while (pairs != NULL) {
+		struct thread *next = pairs->donor_next;
+
+		pairs->donor_next = NULL;
+		root = donor_meld (root, pairs);
+		pairs = next;
+	}
+	return root;
+}
+
+/* Adds DONOR to HOLDER's donor heap. */
+static void
+donor_add (struct thread *holder, struct thread *donor) {
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	donor->donor_child = donor->donor_prev = donor->donor_next = NULL;
+	holder->donors = donor_meld (holder->donors, donor);
+}
+
+/* Removes DONOR from HOLDER's donor heap.  Works even if DONOR's
+   priority changed since it was added. */
+static void
+donor_remove (struct thread *holder, struct thread *donor) {
+	struct thread *children;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	children = donor_merge_pairs (donor->donor_child);
+	if (holder->donors == donor)
+		holder->donors = children;
+	else {
+		ASSERT (donor->donor_prev != NULL);
+		if (donor->donor_prev->donor_child == donor)
+			donor->donor_prev->donor_child = donor->donor_next;
+		else
+			donor->donor_prev->donor_next = donor->donor_next;
+		if (donor->donor_next != NULL)
+			donor->donor_next->donor_prev = donor->donor_prev;
+		holder->donors = donor_meld (holder->donors, children);
+	}
+	donor->donor_child = donor->donor_prev = donor->donor_next = NULL;
+}
+
+/* Sets T's priority to the larger of its own priority and its
+   highest donation.  Returns true if that changed T's priority. */
+static bool
+refresh_priority (struct thread *t) {
+	int priority = t->origin_priority;
+
+	if (t->donors != NULL && t->donors->priority > priority)
+		priority = t->donors->priority;
+	if (priority == t->priority)
+		return false;
+	thread_update_priority (t, priority);
+	return true;
+}
+
+/* T's donors changed.  Recomputes T's priority and carries any
+   change along the chain of lock holders, stopping at the first
+   thread whose priority stays the same.  There is no depth limit. */
+static void
+donate_priority (struct thread *t) {
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	while (refresh_priority (t)
+			&& t->wait_on_lock != NULL && t->wait_on_lock->holder != NULL) {
+		struct thread *holder = t->wait_on_lock->holder;
+
+		/* T's key changed, so put it back in the right place. */
+		donor_remove (holder, t);
+		donor_add (holder, t);
+		t = holder;
 	}
 }
\ No newline at end of file
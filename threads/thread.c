@@ -9,6 +9,7 @@
 #include "threads/interrupt.h"
 #include "threads/intr-stubs.h"
 #include "threads/palloc.h"
+#include "threads/switch.h"
 #include "threads/synch.h"
 #include "threads/vaddr.h"
 #include "intrinsic.h"
@@ -30,11 +31,29 @@
 #define RECENT_CPU_DEFAULT 0
 #define LOAD_AVG_DEFAULT 0
 
-/* List of processes in THREAD_READY state, that is, processes
-   that are ready to run but not actually running. */
-static struct list ready_list;
-
-static struct list bedroom_list;
+/* Processes in THREAD_READY state, that is, processes that are
+   ready to run but not actually running.  There is one FIFO queue
+   per priority; bit (PRI_MAX - P) of ready_bitmap is set while
+   ready_queues[P] is non-empty, so the highest non-empty queue is
+   found with a single find-first-set. */
+static struct list ready_queues[PRI_MAX + 1];
+static uint64_t ready_bitmap;
+static size_t ready_cnt;        /* # of threads in all ready queues. */
+
+/* List of all threads.  Threads are added when they are first
+   initialized and removed when they exit. */
+static struct list all_list;
+
+/* Threads whose recent_cpu went up since the last time priorities
+   were recomputed.  Under MLFQS these are the only threads whose
+   priority can change between two once-a-second updates. */
+static struct list mlfqs_dirty_list;
+
+/* Kernel thread that applies the once-a-second recent_cpu decay,
+   so that the timer interrupt does not have to visit every thread. */
+static struct thread *mlfqs_thread;
+static struct semaphore mlfqs_sema;
+static struct list_elem mlfqs_cursor;   /* Position in all_list. */
 
 /* Idle thread. */
 static struct thread *idle_thread;
@@ -54,6 +73,10 @@ static long long idle_ticks;    /* # of timer ticks spent idle. */
 static long long kernel_ticks;  /* # of timer ticks in kernel threads. */
 static long long user_ticks;    /* # of timer ticks in user programs. */
 
+/* Scheduler statistics of threads that have exited, summed. */
+static struct schedstat exited_stats;
+static int exited_cnt;
+
 /* Scheduling. */
 #define TIME_SLICE 4            /* # of timer ticks to give each thread. */
 static unsigned thread_ticks;   /* # of timer ticks since last yield. */
@@ -75,6 +98,10 @@ static void init_thread (struct thread *, const char *name, int priority);
 static void do_schedule(int status);
 static void schedule (void);
 static tid_t allocate_tid (void);
+static void ready_push (struct thread *);
+static void ready_remove (struct thread *);
+static int ready_max_priority (void);
+static void mlfqs_daemon (void *aux UNUSED);
 
 
 
@@ -121,9 +148,14 @@ thread_init (void) {
 	lgdt (&gdt_ds);
 
 	/* Init the globla thread context */
+	lock_stats_init ();
 	lock_init (&tid_lock);
-	list_init (&ready_list);
-	list_init (&bedroom_list);
+	for (int pri = PRI_MIN; pri <= PRI_MAX; pri++)
+		list_init (&ready_queues[pri]);
+	ready_bitmap = 0;
+	ready_cnt = 0;
+	list_init (&all_list);
+	list_init (&mlfqs_dirty_list);
 	list_init (&destruction_req);
 
 	/* Set up a thread structure for the running thread. */
@@ -142,6 +174,10 @@ thread_start (void) {
 	sema_init (&idle_started, 0);
 	thread_create ("idle", PRI_MIN, idle, &idle_started);
 	load_avg = LOAD_AVG_DEFAULT;
+	if (thread_mlfqs) {
+		sema_init (&mlfqs_sema, 0);
+		thread_create ("mlfqs", PRI_MAX, mlfqs_daemon, NULL);
+	}
 	/* Start preemptive thread scheduling. */
 	intr_enable ();
 
@@ -159,17 +195,29 @@ thread_tick (void) {
 	if (t == idle_thread)
 		idle_ticks++;
 #ifdef USERPROG
-	else if (t->pml4 != NULL)
+	else if (t->pml4 != NULL) {
 		user_ticks++;
+		t->stats.user_ticks++;
+	}
 #endif
-	else
+	else {
 		kernel_ticks++;
+		t->stats.kernel_ticks++;
+	}
 
 	/* Enforce preemption. */
 	if (++thread_ticks >= TIME_SLICE)
 		intr_yield_on_return ();
 }
 
+/* Counts a tick the idle thread slept through without a timer
+   interrupt.  Called by timer_idle_exit() with interrupts off. */
+void
+thread_idle_tick (void) {
+	ASSERT (intr_get_level () == INTR_OFF);
+	idle_ticks++;
+}
+
 /* Prints thread statistics. */
 void
 thread_print_stats (void) {
@@ -177,6 +225,57 @@ thread_print_stats (void) {
 			idle_ticks, kernel_ticks, user_ticks);
 }
 
+static void
+print_schedstat (const char *name, int tid, const struct schedstat *st) {
+	printf ("  %-16s %5d %8lld %8lld %8lld %8lld %8lld %8lld\n", name, tid,
+			(long long) st->user_ticks, (long long) st->kernel_ticks,
+			(long long) st->ready_ticks, (long long) st->lock_wait_ticks,
+			(long long) st->voluntary_switches,
+			(long long) st->involuntary_switches);
+}
+
+/* Prints the scheduler statistics of every live thread, and the
+   totals for the threads that have already exited. */
+void
+thread_print_schedstats (void) {
+	struct list_elem *e;
+
+	printf ("Schedstat: %-16s %5s %8s %8s %8s %8s %8s %8s\n", "name", "tid",
+			"user", "kernel", "ready", "lockwait", "vcsw", "ivcsw");
+	for (e = list_begin (&all_list); e != list_end (&all_list);
+			e = list_next (e)) {
+		struct thread *t = list_entry (e, struct thread, all_elem);
+		print_schedstat (t->name, t->tid, &t->stats);
+	}
+	if (exited_cnt > 0)
+		print_schedstat ("(exited)", exited_cnt, &exited_stats);
+}
+
+/* Copies the scheduler statistics of the thread with TID, or of
+   the running thread if TID is 0, into *ST.  Returns false if there
+   is no such thread. */
+bool
+thread_get_schedstat (tid_t tid, struct schedstat *st) {
+	enum intr_level old_level;
+	struct list_elem *e;
+	bool found = false;
+
+	old_level = intr_disable ();
+	if (tid == 0)
+		tid = thread_current ()->tid;
+	for (e = list_begin (&all_list); e != list_end (&all_list);
+			e = list_next (e)) {
+		struct thread *t = list_entry (e, struct thread, all_elem);
+		if (t->tid == tid) {
+			*st = t->stats;
+			found = true;
+			break;
+		}
+	}
+	intr_set_level (old_level);
+	return found;
+}
+
 /* Creates a new kernel thread named NAME with the given initial
    PRIORITY, which executes FUNCTION passing AUX as the argument,
    and adds it to the ready queue.  Returns the thread identifier
@@ -214,16 +313,17 @@ thread_create (const char *name, int priority,
 	//printf("\n\n child name : %s\n\n", t->name);
 	tid = t->tid = allocate_tid ();
 
-	/* Call the kernel_thread if it scheduled.
-	 * Note) rdi is 1st argument, and rsi is 2nd argument. */
-	t->tf.rip = (uintptr_t) kernel_thread;
-	t->tf.R.rdi = (uint64_t) function;
-	t->tf.R.rsi = (uint64_t) aux;
-	t->tf.ds = SEL_KDSEG;
-	t->tf.es = SEL_KDSEG;
-	t->tf.ss = SEL_KDSEG;
-	t->tf.cs = SEL_KCSEG;
-	t->tf.eflags = FLAG_IF;
+	/* Call the kernel_thread if it scheduled: switch_threads()
+	 * returns into switch_entry, which calls kernel_thread (FUNCTION,
+	 * AUX) at the top of the new thread's stack. */
+	struct switch_threads_frame *sf =
+		(struct switch_threads_frame *) ((uint8_t *) t + PGSIZE) - 1;
+	memset (sf, 0, sizeof *sf);
+	sf->rbx = (uint64_t) kernel_thread;
+	sf->r12 = (uint64_t) function;
+	sf->r13 = (uint64_t) aux;
+	sf->rip = switch_entry;
+	t->switch_rsp = sf;
 
 	/* Add to run queue. */
 	thread_unblock (t);
@@ -262,9 +362,9 @@ thread_unblock (struct thread *t) {
 
 	old_level = intr_disable ();
 	ASSERT (t->status == THREAD_BLOCKED);
-	//list_push_back (&ready_list, &t->elem);
-	list_insert_ordered(&ready_list, &t->elem, cmp_priority, NULL);
+	ready_push (t);
 	t->status = THREAD_READY;
+	t->ready_since = timer_ticks ();
 	intr_set_level (old_level);
 }
 
@@ -311,6 +411,16 @@ thread_exit (void) {
 	/* Just set our status to dying and schedule another process.
 	   We will be destroyed during the call to schedule_tail(). */
 	intr_disable ();
+	exited_stats.user_ticks += thread_current ()->stats.user_ticks;
+	exited_stats.kernel_ticks += thread_current ()->stats.kernel_ticks;
+	exited_stats.ready_ticks += thread_current ()->stats.ready_ticks;
+	exited_stats.lock_wait_ticks += thread_current ()->stats.lock_wait_ticks;
+	exited_stats.voluntary_switches += thread_current ()->stats.voluntary_switches;
+	exited_stats.involuntary_switches += thread_current ()->stats.involuntary_switches;
+	exited_cnt++;
+	list_remove (&thread_current ()->all_elem);
+	if (thread_current ()->mlfqs_dirty)
+		list_remove (&thread_current ()->mlfqs_elem);
 	do_schedule (THREAD_DYING);
 	NOT_REACHED ();
 }
@@ -325,9 +435,10 @@ thread_yield (void) {
 	ASSERT (!intr_context ());
 
 	old_level = intr_disable ();
-	if (curr != idle_thread)
-		//list_push_back (&ready_list, &curr->elem);
-		list_insert_ordered(&ready_list, &curr->elem, cmp_priority, NULL);
+	if (curr != idle_thread) {
+		ready_push (curr);
+		curr->ready_since = timer_ticks ();
+	}
 	do_schedule (THREAD_READY);
 	intr_set_level (old_level);
 }
@@ -343,12 +454,9 @@ thread_set_priority (int new_priority) {
 	//revert priority
 	now_thread->priority = now_thread->origin_priority;
 
-	if(!list_empty(&now_thread->donations)){
-		struct list_elem *h_elem = list_max(&now_thread->donations, cmp_doner_priority, NULL);
-		struct thread *cmp_thread = list_entry(h_elem, struct thread, d_elem);
-		if(now_thread->priority < cmp_thread->priority){
-			now_thread->priority = cmp_thread->priority;
-		}
+	/* The top of the donor heap is our highest donation. */
+	if(now_thread->donors != NULL && now_thread->priority < now_thread->donors->priority){
+		now_thread->priority = now_thread->donors->priority;
 	}
 	thread_change_by_priority();
 }
@@ -431,6 +539,10 @@ idle (void *idle_started_ UNUSED) {
 		intr_disable ();
 		thread_block ();
 
+		/* Nothing else can run, so stop the periodic tick until the
+		   next timer deadline. */
+		timer_idle_enter ();
+
 		/* Re-enable interrupts and wait for the next one.
 
 		   The `sti' instruction disables interrupts until the
@@ -462,6 +574,8 @@ kernel_thread (thread_func *function, void *aux) {
    NAME. */
 static void
 init_thread (struct thread *t, const char *name, int priority) {
+	enum intr_level old_level;
+
 	ASSERT (t != NULL);
 	ASSERT (PRI_MIN <= priority && priority <= PRI_MAX);
 	ASSERT (name != NULL);
@@ -473,7 +587,6 @@ init_thread (struct thread *t, const char *name, int priority) {
 	t->priority = priority;
 	t->magic    = THREAD_MAGIC;
 
-	list_init(&t->donations);
 	t->wait_on_lock    = NULL;
 	t->origin_priority = priority;
 
@@ -481,18 +594,16 @@ init_thread (struct thread *t, const char *name, int priority) {
 	t->recent_cpu = RECENT_CPU_DEFAULT;
 
 	t->is_exit = 0;
-	//t->next_fd = 3;
-
-	for(int i=2; i < MAX_FDT; i++){
-		t->fdt[i] = NULL;
-	}
-
 
 	list_init(&t->child_list);
 	sema_init(&t->wait_sema, 0);
 	sema_init(&t->fork_sema, 0);
 	sema_init(&t->succ_sema, 0);
 	//struct lock list_lock; //child_list update lock
+
+	old_level = intr_disable ();
+	list_push_back (&all_list, &t->all_elem);
+	intr_set_level (old_level);
 	
 
 }
@@ -504,10 +615,76 @@ init_thread (struct thread *t, const char *name, int priority) {
    idle_thread. */
 static struct thread *
 next_thread_to_run (void) {
-	if (list_empty (&ready_list))
+	struct thread *t;
+	int pri;
+
+	if (ready_bitmap == 0)
 		return idle_thread;
-	else
-		return list_entry (list_pop_front (&ready_list), struct thread, elem);
+
+	pri = ready_max_priority ();
+	t = list_entry (list_pop_front (&ready_queues[pri]), struct thread, elem);
+	if (list_empty (&ready_queues[pri]))
+		ready_bitmap &= ~(1ULL << (PRI_MAX - pri));
+	ready_cnt--;
+	return t;
+}
+
+/* Appends T to the ready queue of its priority. */
+static void
+ready_push (struct thread *t) {
+	ASSERT (intr_get_level () == INTR_OFF);
+	ASSERT (PRI_MIN <= t->priority && t->priority <= PRI_MAX);
+
+	list_push_back (&ready_queues[t->priority], &t->elem);
+	ready_bitmap |= 1ULL << (PRI_MAX - t->priority);
+	ready_cnt++;
+}
+
+/* Takes T, which must be in the ready queue of its current
+   priority, out of that queue. */
+static void
+ready_remove (struct thread *t) {
+	ASSERT (intr_get_level () == INTR_OFF);
+	ASSERT (t->status == THREAD_READY);
+
+	list_remove (&t->elem);
+	if (list_empty (&ready_queues[t->priority]))
+		ready_bitmap &= ~(1ULL << (PRI_MAX - t->priority));
+	ready_cnt--;
+}
+
+/* Returns the highest priority that has a ready thread.  The ready
+   queues must not all be empty. */
+static int
+ready_max_priority (void) {
+	ASSERT (ready_bitmap != 0);
+	return PRI_MAX - (__builtin_ffsll (ready_bitmap) - 1);
+}
+
+/* Changes T's effective priority to PRIORITY, moving T to the
+   matching ready queue if it is waiting to run, or to its new place
+   in a semaphore's wait list if it is blocked on one. */
+void
+thread_update_priority (struct thread *t, int priority) {
+	enum intr_level old_level;
+
+	ASSERT (is_thread (t));
+	ASSERT (PRI_MIN <= priority && priority <= PRI_MAX);
+
+	old_level = intr_disable ();
+	if (t->priority != priority) {
+		if (t->status == THREAD_READY) {
+			ready_remove (t);
+			t->priority = priority;
+			ready_push (t);
+		} else if (t->status == THREAD_BLOCKED && t->wait_list != NULL) {
+			list_remove (&t->elem);
+			t->priority = priority;
+			list_insert_ordered (t->wait_list, &t->elem, cmp_priority, NULL);
+		} else
+			t->priority = priority;
+	}
+	intr_set_level (old_level);
 }
 
 /* Use iretq to launch the thread */
@@ -550,61 +727,13 @@ do_iret (struct intr_frame *tf) {
    added at the end of the function. */
 static void
 thread_launch (struct thread *th) {
-	uint64_t tf_cur = (uint64_t) &running_thread ()->tf;
-	uint64_t tf = (uint64_t) &th->tf;
+	struct thread *cur = running_thread ();
 	ASSERT (intr_get_level () == INTR_OFF);
 
-	/* The main switching logic.
-	 * We first restore the whole execution context into the intr_frame
-	 * and then switching to the next thread by calling do_iret.
-	 * Note that, we SHOULD NOT use any stack from here
-	 * until switching is done. */
-	__asm __volatile (
-			/* Store registers that will be used. */
-			"push %%rax\n"
-			"push %%rbx\n"
-			"push %%rcx\n"
-			/* Fetch input once */
-			"movq %0, %%rax\n"
-			"movq %1, %%rcx\n"
-			"movq %%r15, 0(%%rax)\n"
-			"movq %%r14, 8(%%rax)\n"
-			"movq %%r13, 16(%%rax)\n"
-			"movq %%r12, 24(%%rax)\n"
-			"movq %%r11, 32(%%rax)\n"
-			"movq %%r10, 40(%%rax)\n"
-			"movq %%r9, 48(%%rax)\n"
-			"movq %%r8, 56(%%rax)\n"
-			"movq %%rsi, 64(%%rax)\n"
-			"movq %%rdi, 72(%%rax)\n"
-			"movq %%rbp, 80(%%rax)\n"
-			"movq %%rdx, 88(%%rax)\n"
-			"pop %%rbx\n"              // Saved rcx
-			"movq %%rbx, 96(%%rax)\n"
-			"pop %%rbx\n"              // Saved rbx
-			"movq %%rbx, 104(%%rax)\n"
-			"pop %%rbx\n"              // Saved rax
-			"movq %%rbx, 112(%%rax)\n"
-			"addq $120, %%rax\n"
-			"movw %%es, (%%rax)\n"
-			"movw %%ds, 8(%%rax)\n"
-			"addq $32, %%rax\n"
-			"call __next\n"         // read the current rip.
-			"__next:\n"
-			"pop %%rbx\n"
-			"addq $(out_iret -  __next), %%rbx\n"
-			"movq %%rbx, 0(%%rax)\n" // rip
-			"movw %%cs, 8(%%rax)\n"  // cs
-			"pushfq\n"
-			"popq %%rbx\n"
-			"mov %%rbx, 16(%%rax)\n" // eflags
-			"mov %%rsp, 24(%%rax)\n" // rsp
-			"movw %%ss, 32(%%rax)\n"
-			"mov %%rcx, %%rdi\n"
-			"call do_iret\n"
-			"out_iret:\n"
-			: : "g"(tf_cur), "g" (tf) : "memory"
-			);
+	/* Scheduling always happens inside the kernel, so only the
+	 * callee-saved registers and the stack pointer need to be kept.
+	 * Returning to user mode goes through do_iret() separately. */
+	switch_threads (&cur->switch_rsp, th->switch_rsp);
 }
 
 /* Schedules a new process. At entry, interrupts must be off.
@@ -635,6 +764,10 @@ schedule (void) {
 	/* Mark us as running. */
 	next->status = THREAD_RUNNING;
 
+	/* Leaving the idle thread: go back to the periodic tick. */
+	if (curr == idle_thread)
+		timer_idle_exit ();
+
 	/* Start new time slice. */
 	thread_ticks = 0;
 
@@ -644,6 +777,15 @@ schedule (void) {
 #endif
 
 	if (curr != next) {
+		/* Account the switch.  Leaving while still runnable means we
+		   were preempted. */
+		if (curr->status == THREAD_READY)
+			curr->stats.involuntary_switches++;
+		else
+			curr->stats.voluntary_switches++;
+		if (next != idle_thread)
+			next->stats.ready_ticks += timer_ticks () - next->ready_since;
+
 		/* If the thread we switched from is dying, destroy its struct
 		   thread. This must happen late so that thread_exit() doesn't
 		   pull out the rug under itself.
@@ -675,35 +817,25 @@ allocate_tid (void) {
 	return tid;
 }
 
+static void
+thread_sleep_expired (void *t) {
+	thread_unblock (t);
+}
+
+/* Blocks the current thread until tick START + TICKS. */
 void thread_sleep(int64_t start, int64_t ticks){
 	struct thread *now_thread;
 	enum intr_level old_level;
 	now_thread = thread_current();
-	//set expire tick
 	old_level = intr_disable ();
 	if(now_thread != idle_thread){
-		now_thread->wake_tick = start+ticks;
-		//list_push_back(&bedroom_list, &now_thread->elem);
-		list_insert_ordered(&bedroom_list, &now_thread->elem, cmp_wake_ticks, NULL);
+		timer_callout_init(&now_thread->sleep_timer, thread_sleep_expired, now_thread);
+		timer_callout_add(&now_thread->sleep_timer, start + ticks);
 		thread_block();	
 	}
 	intr_set_level(old_level);
 }
 
-void thread_wake(int64_t ticks){
-	struct list_elem *sleep_node = list_begin(&bedroom_list);
-
-	while(sleep_node != list_tail(&bedroom_list)){
-		struct thread *target_thread = list_entry(sleep_node, struct thread, elem);
-		if(target_thread->wake_tick <= ticks){
-			sleep_node = list_remove(sleep_node);
-			thread_unblock(target_thread);
-		} else{
-			break;
-		}
-	}
-}
-
 bool
 cmp_priority (const struct list_elem *a_, const struct list_elem *b_,
             void *aux UNUSED) 
@@ -714,34 +846,12 @@ cmp_priority (const struct list_elem *a_, const struct list_elem *b_,
   	return a->priority > b->priority;
 }
 
-bool
-cmp_wake_ticks (const struct list_elem *a_, const struct list_elem *b_,
-            void *aux UNUSED) 
-{
-	struct thread *a = list_entry (a_, struct thread, elem);
-  	struct thread *b = list_entry (b_, struct thread, elem);
-  
-  	return a->wake_tick < b->wake_tick;
-}
-
-bool
-cmp_doner_priority (const struct list_elem *a_, const struct list_elem *b_,
-            void *aux UNUSED) 
-{
-  const struct thread *a = list_entry (a_, struct thread, d_elem);
-  const struct thread *b = list_entry (b_, struct thread, d_elem);
-  
-  return a->priority > b->priority;
-}
-
 void
 thread_change_by_priority(void){
-	if(!list_empty(&ready_list)&&!intr_context()){
+	if(ready_bitmap != 0 && !intr_context()){
 		struct thread *now_thread = thread_current();
-		struct list_elem *ready_node = list_begin(&ready_list);
-		struct thread *first_thread = list_entry(ready_node, struct thread, elem);
 
-		if(first_thread->priority > now_thread->priority ){
+		if(ready_max_priority() > now_thread->priority ){
 			thread_yield();
 		}
 	}
@@ -750,7 +860,7 @@ thread_change_by_priority(void){
 //MLFQS
 void 
 mlfqs_priority(struct thread *t){
-	if(t == idle_thread)
+	if(t == idle_thread || t == mlfqs_thread)
 		return;
 	/*
 	int clac_priority = fp_to_int(sub_fp(sub_fp(int_to_fp(PRI_MAX), div_fp(t->recent_cpu, int_to_fp(4))), int_to_fp((t->nice * 2))));
@@ -766,12 +876,12 @@ mlfqs_priority(struct thread *t){
 		clac_priority = PRI_MAX;
 	if (clac_priority < PRI_MIN)
 		clac_priority = PRI_MIN;
-	t->priority = clac_priority;
+	thread_update_priority(t, clac_priority);
 }
 
 void
 mlfqs_recent_cpu(struct thread *t){
-	if(t == idle_thread)
+	if(t == idle_thread || t == mlfqs_thread)
 		return;
 /*
 	int recent_cpu = add_fp(mult_fp(div_fp(mult_fp(int_to_fp(2), load_avg), add_fp(mult_fp(int_to_fp(2), load_avg), int_to_fp(1))), t->recent_cpu), int_to_fp(t->nice));
@@ -784,11 +894,14 @@ mlfqs_recent_cpu(struct thread *t){
 void
 mlfqs_load_avg(void){
 	int ready_threads; //running Thread
-	if(thread_current() == idle_thread){
-		ready_threads = list_size(&ready_list);
+	struct thread *cur = thread_current();
+	if(cur == idle_thread || cur == mlfqs_thread){
+		ready_threads = ready_cnt;
 	} else {
-		ready_threads = list_size(&ready_list) + 1; //running Thread
+		ready_threads = ready_cnt + 1; //running Thread
 	}
+	if(mlfqs_thread != NULL && mlfqs_thread->status == THREAD_READY)
+		ready_threads--;
 /*
 	load_avg = add_fp(mult_fp(div_fp(int_to_fp(59), int_to_fp(60)), load_avg), mult_fp(div_fp(int_to_fp(1), int_to_fp(60)), int_to_fp(ready_threads)));
 */
@@ -798,51 +911,67 @@ mlfqs_load_avg(void){
 
 void 
 mlfqs_increment(void){
-	if(thread_current() == idle_thread)
+	struct thread *cur = thread_current();
+	if(cur == idle_thread || cur == mlfqs_thread)
 		return;
 
-	thread_current()->recent_cpu = add_mixed(thread_current()->recent_cpu, 1);
-
+	cur->recent_cpu = add_mixed(cur->recent_cpu, 1);
+	if(!cur->mlfqs_dirty){
+		cur->mlfqs_dirty = true;
+		list_push_back(&mlfqs_dirty_list, &cur->mlfqs_elem);
+	}
 }
+/* Recomputes the priority of the threads whose recent_cpu changed
+   since the last call.  Runs in the timer interrupt. */
 void 
 mlfqs_recalc_priority(void){
-	struct list_elem *bed_elem = list_begin(&bedroom_list);
-	struct list_elem *ready_elem = list_begin(&ready_list);
-	mlfqs_priority(thread_current());
-	if(!list_empty(&ready_list)){
-		while(ready_elem != list_end(&ready_list)){
-			struct thread *now_thread = list_entry(ready_elem, struct thread, elem);
-			mlfqs_priority(now_thread);
-			ready_elem = list_next(ready_elem);
-		}
-	}
-	if(!list_empty(&bedroom_list)){
-		while(bed_elem != list_end(&bedroom_list)){
-			struct thread *now_thread = list_entry(bed_elem, struct thread, elem);
-			mlfqs_priority(now_thread);
-			bed_elem = list_next(bed_elem);
-		}
+	while(!list_empty(&mlfqs_dirty_list)){
+		struct thread *t = list_entry(list_pop_front(&mlfqs_dirty_list), struct thread, mlfqs_elem);
+		t->mlfqs_dirty = false;
+		mlfqs_priority(t);
 	}
+	mlfqs_priority(thread_current());
 }
 
+/* Asks the MLFQS thread to decay every thread's recent_cpu.  Runs
+   in the timer interrupt, once a second. */
 void 
 mlfqs_recalc_recent_cpu(void){
-	struct list_elem *bed_elem = list_begin(&bedroom_list);
-	struct list_elem *ready_elem = list_begin(&ready_list);
-	mlfqs_recent_cpu(thread_current());
-	if(!list_empty(&ready_list)){
-		while(ready_elem != list_end(&ready_list)){
-			struct thread *now_thread = list_entry(ready_elem, struct thread, elem);
-			mlfqs_recent_cpu(now_thread);
-			ready_elem = list_next(ready_elem);
-		}
-	}
+	if(mlfqs_thread == NULL)
+		return;
+	sema_up(&mlfqs_sema);
+	intr_yield_on_return();
+}
+
+/* Walks all_list once per mlfqs_recalc_recent_cpu() call, decaying
+   recent_cpu and recomputing the priority of each thread.  Interrupts
+   are only turned off for one thread at a time; a cursor element kept
+   in all_list marks our position, so threads may come and go while
+   the walk is in progress. */
+static void
+mlfqs_daemon (void *aux UNUSED) {
+	mlfqs_thread = thread_current ();
 
-	if(!list_empty(&bedroom_list)){
-		while(bed_elem != list_end(&bedroom_list)){
-			struct thread *now_thread = list_entry(bed_elem, struct thread, elem);
-			mlfqs_recent_cpu(now_thread);
-			bed_elem = list_next(bed_elem);
+	for (;;) {
+		enum intr_level old_level;
+
+		sema_down (&mlfqs_sema);
+
+		old_level = intr_disable ();
+		list_push_front (&all_list, &mlfqs_cursor);
+		while (list_next (&mlfqs_cursor) != list_end (&all_list)) {
+			struct list_elem *e = list_next (&mlfqs_cursor);
+			struct thread *t = list_entry (e, struct thread, all_elem);
+
+			list_remove (&mlfqs_cursor);
+			list_insert (list_next (e), &mlfqs_cursor);
+			mlfqs_recent_cpu (t);
+			mlfqs_priority (t);
+
+			intr_set_level (old_level);
+			old_level = intr_disable ();
 		}
+		list_remove (&mlfqs_cursor);
+		intr_set_level (old_level);
 	}
-}
\ No newline at end of file
+}
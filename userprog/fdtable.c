@@ -0,0 +1,254 @@
+/* fdtable.c: Per-process file descriptor tables.
+ *
+ * Only user processes have a table, allocated on demand and grown by
+ * doubling as descriptors are opened.  A bitmap of allocated slots makes
+ * finding the lowest free descriptor a matter of looking at one word in
+ * the common case.
+ *
+ * fork() does not copy the parent's table.  Parent and child share it,
+ * and whichever of them first uses a descriptor makes itself a private
+ * copy with fd_table_unshare().  A child that execs and never touches
+ * its descriptors never pays for the copy.
+ *
+ * Files are duplicated and closed under filesys_lock, so none of these
+ * functions may be called with it held. */
+
+#include "userprog/fdtable.h"
+#include <debug.h>
+#include <string.h>
+#include "filesys/file.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
+#include "userprog/syscall.h"
+
+#define WORD_BITS 64
+
+/* Protects the reference counts of all tables. */
+static struct lock fdt_lock;
+
+static struct fd_table *fd_table_alloc (int size);
+static bool fd_table_grow (struct fd_table *, int size);
+
+static inline void
+set_used (struct fd_table *t, int fd, bool used) {
+	uint64_t mask = (uint64_t) 1 << (fd % WORD_BITS);
+
+	if (used)
+		t->used[fd / WORD_BITS] |= mask;
+	else {
+		t->used[fd / WORD_BITS] &= ~mask;
+		if (fd / WORD_BITS < t->hint)
+			t->hint = fd / WORD_BITS;
+	}
+}
+
+void
+fd_table_init (void) {
+	lock_init (&fdt_lock);
+}
+
+/* Returns a new, empty table, or a null pointer if memory is short. */
+struct fd_table *
+fd_table_create (void) {
+	return fd_table_alloc (FDT_INIT_SIZE);
+}
+
+/* Returns T with one more reference, for a forked child. */
+struct fd_table *
+fd_table_share (struct fd_table *t) {
+	if (t != NULL) {
+		lock_acquire (&fdt_lock);
+		t->ref_cnt++;
+		lock_release (&fdt_lock);
+	}
+	return t;
+}
+
+/* Makes *T private to the caller, replacing it by a copy with duplicated
+ * files if it is shared.  Returns false if memory is short, in which
+ * case *T is left shared. */
+bool
+fd_table_unshare (struct fd_table **t) {
+	struct fd_table *old = *t, *copy = NULL;
+	bool success = true;
+
+	if (old->ref_cnt == 1)
+		return true;
+
+	lock_acquire (&fdt_lock);
+	if (old->ref_cnt > 1) {
+		copy = fd_table_alloc (old->size);
+		if (copy == NULL)
+			success = false;
+		else {
+			lock_acquire (&filesys_lock);
+			for (int fd = 0; fd < old->size; fd++) {
+				if (old->files[fd] == NULL)
+					continue;
+				copy->files[fd] = file_duplicate (old->files[fd]);
+				if (copy->files[fd] == NULL) {
+					success = false;
+					break;
+				}
+				set_used (copy, fd, true);
+			}
+			lock_release (&filesys_lock);
+			if (success) {
+				old->ref_cnt--;
+				*t = copy;
+			}
+		}
+	}
+	lock_release (&fdt_lock);
+
+	if (!success && copy != NULL)
+		fd_table_release (copy);
+	return success;
+}
+
+/* Drops a reference to T, closing its files with the last one. */
+void
+fd_table_release (struct fd_table *t) {
+	bool last;
+
+	if (t == NULL)
+		return;
+
+	lock_acquire (&fdt_lock);
+	last = --t->ref_cnt == 0;
+	lock_release (&fdt_lock);
+	if (!last)
+		return;
+
+	lock_acquire (&filesys_lock);
+	for (int fd = 0; fd < t->size; fd++)
+		file_close (t->files[fd]);
+	lock_release (&filesys_lock);
+	free (t->files);
+	free (t->used);
+	free (t);
+}
+
+/* Returns the file open as FD in T, or a null pointer. */
+struct file *
+fd_table_get (const struct fd_table *t, int fd) {
+	if (fd < 0 || fd >= t->size)
+		return NULL;
+	return t->files[fd];
+}
+
+/* Installs FILE in T under the lowest free descriptor and returns it,
+ * or returns -1 if T is full. */
+int
+fd_table_add (struct fd_table *t, struct file *file) {
+	int words = t->size / WORD_BITS;
+	int w;
+
+	ASSERT (t->ref_cnt == 1);
+
+	for (w = t->hint; w < words; w++)
+		if (t->used[w] != UINT64_MAX)
+			break;
+	t->hint = w;
+	if (w == words && !fd_table_grow (t, t->size * 2))
+		return -1;
+
+	int fd = w * WORD_BITS + __builtin_ctzll (~t->used[w]);
+	t->files[fd] = file;
+	set_used (t, fd, true);
+	return fd;
+}
+
+/* Installs FILE in T as descriptor FD, closing whatever FD referred to.
+ * Installing a file as descriptor 0 or 1 redirects it away from the
+ * console.  Returns false if FD is out of range or memory is short. */
+bool
+fd_table_install (struct fd_table *t, int fd, struct file *file) {
+	ASSERT (t->ref_cnt == 1);
+
+	if (fd < 0 || fd >= FDT_MAX)
+		return false;
+	if (fd >= t->size) {
+		int size = t->size;
+		while (size <= fd)
+			size *= 2;
+		if (!fd_table_grow (t, size))
+			return false;
+	}
+
+	lock_acquire (&filesys_lock);
+	file_close (t->files[fd]);
+	lock_release (&filesys_lock);
+	t->files[fd] = file;
+	set_used (t, fd, true);
+	return true;
+}
+
+/* Removes FD from T and returns the file it referred to, or a null
+ * pointer if FD was not open.  The caller closes the file.  Descriptors
+ * 0 and 1 go back to the console and stay reserved. */
+struct file *
+fd_table_remove (struct fd_table *t, int fd) {
+	struct file *file;
+
+	ASSERT (t->ref_cnt == 1);
+
+	if (fd < 0 || fd >= t->size || t->files[fd] == NULL)
+		return NULL;
+	file = t->files[fd];
+	t->files[fd] = NULL;
+	if (fd >= 2)
+		set_used (t, fd, false);
+	return file;
+}
+
+/* Allocates a table with SIZE empty slots. */
+static struct fd_table *
+fd_table_alloc (int size) {
+	struct fd_table *t = malloc (sizeof *t);
+
+	if (t == NULL)
+		return NULL;
+	t->ref_cnt = 1;
+	t->size = size;
+	t->hint = 0;
+	t->files = calloc (size, sizeof *t->files);
+	t->used = calloc (size / WORD_BITS, sizeof *t->used);
+	if (t->files == NULL || t->used == NULL) {
+		free (t->files);
+		free (t->used);
+		free (t);
+		return NULL;
+	}
+
+	/* The console descriptors are never handed out. */
+	set_used (t, 0, true);
+	set_used (t, 1, true);
+	return t;
+}
+
+/* Grows T to SIZE slots, at most FDT_MAX. */
+static bool
+fd_table_grow (struct fd_table *t, int size) {
+	struct file **files;
+	uint64_t *used;
+
+	if (size > FDT_MAX)
+		return false;
+	files = calloc (size, sizeof *files);
+	used = calloc (size / WORD_BITS, sizeof *used);
+	if (files == NULL || used == NULL) {
+		free (files);
+		free (used);
+		return false;
+	}
+
+	memcpy (files, t->files, t->size * sizeof *files);
+	memcpy (used, t->used, t->size / WORD_BITS * sizeof *used);
+	free (t->files);
+	free (t->used);
+	t->files = files;
+	t->used = used;
+	t->size = size;
+	return true;
+}
@@ -5,14 +5,17 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include "userprog/fdtable.h"
 #include "userprog/gdt.h"
 #include "userprog/tss.h"
 #include "filesys/directory.h"
 #include "filesys/file.h"
 #include "filesys/filesys.h"
+#include "filesys/inode.h"
 #include "threads/flags.h"
 #include "threads/init.h"
 #include "threads/interrupt.h"
+#include "threads/malloc.h"
 #include "threads/palloc.h"
 #include "threads/thread.h"
 #include "threads/mmu.h"
@@ -27,14 +30,20 @@ static void process_cleanup (void);
 static bool load (const char *file_name, struct intr_frame *if_);
 static void initd (void *f_name);
 static void __do_fork (void *);
+static void __do_spawn (void *);
+static bool spawn_apply_actions (const struct spawn_action *, int);
+static struct fd_table *process_fd_table (void);
 static void argument_stack(char **parse ,int count ,struct intr_frame *_if);
+static void exec_cache_init (void);
 /* General process initializer for initd and other process. */
 static void
 process_init (void) {
 	struct thread *current = thread_current ();
+
+	if (current->fdt == NULL)
+		current->fdt = fd_table_create ();
 }
 struct thread *get_child_process(int pid);
-struct lock process_lock;
 /* Starts the first userland program, called "initd", loaded from FILE_NAME.
  * The new thread may be scheduled (and may even exit)
  * before process_create_initd() returns. Returns the initd's
@@ -45,7 +54,8 @@ process_create_initd (const char *file_name) {
 	char *fn_copy;
 	char *save_ptr;
 	tid_t tid;
-	lock_init(&process_lock);
+	exec_cache_init ();
+	fd_table_init ();
 	/* Make a copy of FILE_NAME.
 	 * Otherwise there's a race between the caller and load(). */
 	fn_copy = palloc_get_page (0);
@@ -182,16 +192,9 @@ __do_fork (void *aux) {
 	 * TODO:       from the fork() until this function successfully duplicates
 	 * TODO:       the resources of parent.*/
 
-	//dupl fdt, next_fd
-	//current->next_fd = parent->next_fd;
-	/*
-	*/
-	for(int i=2; i<MAX_FDT; i++){
-		if(parent->fdt[i] != NULL){
-			struct file *dup_file = file_duplicate(parent->fdt[i]);
-			current->fdt[i] = dup_file;
-		}
-	}
+	/* Share the parent's descriptors; the first of us to use one
+	 * copies the table (see fdtable.c). */
+	current->fdt = fd_table_share (parent->fdt);
 	
 	process_init ();
 	sema_up(&current->fork_sema);
@@ -206,26 +209,188 @@ error:
 	exit(-1);
 	//thread_exit ();
 }
+/* What process_spawn() hands to the new process. */
+struct spawn_args {
+	struct thread *parent;
+	char *cmd_line;                         /* Page, freed by the child. */
+	const struct spawn_action *actions;
+	int action_cnt;
+	bool success;                           /* Set by the child. */
+};
+
+/* Starts a new process running CMD_LINE, a page obtained with
+ * palloc_get_page() that this function takes ownership of.
+ * Unlike fork() followed by exec(), the parent's address space is never
+ * copied: the child starts with a fresh one and only duplicates the
+ * parent's file descriptors, to which ACTIONS are applied (see
+ * <spawn.h>).  Returns the new process's thread id once its executable
+ * has been loaded, or TID_ERROR if the process could not be started. */
+tid_t
+process_spawn (char *cmd_line, const struct spawn_action *actions,
+		int action_cnt) {
+	struct spawn_args args;
+	struct thread *child_thread;
+	char name[sizeof child_thread->name];
+	size_t len;
+	tid_t tid;
+
+	/* The thread is named after the program, without arguments. */
+	len = strcspn (cmd_line, " ");
+	strlcpy (name, cmd_line, len + 1 < sizeof name ? len + 1 : sizeof name);
+
+	args.parent = thread_current ();
+	args.cmd_line = cmd_line;
+	args.actions = actions;
+	args.action_cnt = action_cnt;
+	args.success = false;
+
+	tid = thread_create (name, PRI_DEFAULT, __do_spawn, &args);
+	if (tid == TID_ERROR) {
+		palloc_free_page (cmd_line);
+		return TID_ERROR;
+	}
+	child_thread = get_child_process (tid);
+	sema_down (&child_thread->fork_sema);
+
+	return args.success ? tid : TID_ERROR;
+}
+
+/* A thread function that sets up a spawned process.  ARGS lives on the
+ * parent's stack and must not be touched once fork_sema is up. */
+static void
+__do_spawn (void *aux) {
+	struct spawn_args *args = aux;
+	struct thread *parent = args->parent;
+	struct thread *current = thread_current ();
+	struct intr_frame if_;
+	bool success;
+
+	/* Start out sharing the parent's descriptors, as after fork(). */
+	current->fdt = fd_table_share (parent->fdt);
+
+	process_init ();
+#ifdef VM
+	supplemental_page_table_init (&current->spt);
+#endif
+	if_.ds = if_.es = if_.ss = SEL_UDSEG;
+	if_.cs = SEL_UCSEG;
+	if_.eflags = FLAG_IF | FLAG_MBS;
+
+	success = spawn_apply_actions (args->actions, args->action_cnt);
+	if (success) {
+		success = load (args->cmd_line, &if_);
+	}
+	palloc_free_page (args->cmd_line);
+
+	args->success = success;
+	sema_up (&current->fork_sema);
+	if (!success)
+		exit (-1);
+
+	/* Start the new program. */
+	do_iret (&if_);
+	NOT_REACHED ();
+}
+
+/* Applies the ACTION_CNT file descriptor ACTIONS to the current
+ * process's table.  Returns false on the first invalid action. */
+static bool
+spawn_apply_actions (const struct spawn_action *actions, int action_cnt) {
+	struct fd_table *fdt;
+
+	if (action_cnt == 0)
+		return true;
+	fdt = process_fd_table ();
+	if (fdt == NULL)
+		return false;
+
+	for (int i = 0; i < action_cnt; i++) {
+		const struct spawn_action *a = &actions[i];
+
+		if (a->fd < 0 || a->fd >= FDT_MAX)
+			return false;
+		switch (a->type) {
+			case SPAWN_CLOSE:
+				close (a->fd);
+				break;
+			case SPAWN_CLOSEFROM:
+				for (int fd = a->fd; fd < fdt->size; fd++)
+					close (fd);
+				break;
+			case SPAWN_DUP2:
+				if (fd_table_get (fdt, a->fd) == NULL)
+					return false;
+				if (a->newfd != a->fd) {
+					struct file *dup_file;
+
+					lock_acquire (&filesys_lock);
+					dup_file = file_duplicate (fd_table_get (fdt, a->fd));
+					lock_release (&filesys_lock);
+					if (dup_file == NULL)
+						return false;
+					if (!fd_table_install (fdt, a->newfd, dup_file)) {
+						lock_acquire (&filesys_lock);
+						file_close (dup_file);
+						lock_release (&filesys_lock);
+						return false;
+					}
+				}
+				break;
+			default:
+				return false;
+		}
+	}
+	return true;
+}
+
+/* Returns the current process's descriptor table, made private to the
+ * process first, or a null pointer if there is none. */
+static struct fd_table *
+process_fd_table (void) {
+	struct thread *curr = thread_current ();
+
+	if (curr->fdt == NULL || !fd_table_unshare (&curr->fdt))
+		return NULL;
+	return curr->fdt;
+}
+
+/* Returns true if FD is 0 or 1 and still refers to the console, that
+ * is, no file was installed in its place.  Unlike process_get_file(),
+ * this leaves a table shared with the parent alone. */
+bool
+process_is_console (int fd) {
+	struct fd_table *fdt = thread_current ()->fdt;
+
+	return (fd == 0 || fd == 1)
+		&& (fdt == NULL || fd_table_get (fdt, fd) == NULL);
+}
+
 //fd : 0, 1, 2 -> STDIN, STDOUT, STDERR, always true case -> next_fd > fd 
 struct file *process_get_file (int fd){
-	if(fd < 0 || fd >= MAX_FDT)
+	struct fd_table *fdt = process_fd_table ();
+
+	if (fdt == NULL)
 		return NULL;
-	return thread_current()->fdt[fd];		
+	return fd_table_get (fdt, fd);
 }
 
 int process_add_file(struct file *file){
+	struct fd_table *fdt = process_fd_table ();
 
-	//int now_fd = thread_current()->next_fd;
+	if (fdt == NULL)
+		return -1;
+	return fd_table_add (fdt, file);
+}
 
-	for(int i=2; i<MAX_FDT; i++){
-		if(thread_current()->fdt[i] == NULL){
-			thread_current()->fdt[i] = file;
-			//thread_current()->next_fd = i;
-			return i;
-		}
-	}
-	//thread_current()->next_fd = MAX_FDT;
-	return -1;
+/* Removes FD from the current process's table and returns its file,
+ * which the caller closes, or a null pointer if FD is not open. */
+struct file *
+process_remove_file (int fd) {
+	struct fd_table *fdt = process_fd_table ();
+
+	if (fdt == NULL)
+		return NULL;
+	return fd_table_remove (fdt, fd);
 }
 /* Switch the current execution context to the f_name.
  * Returns -1 on fail. */ //start_process
@@ -247,9 +412,7 @@ process_exec (void *f_name) {
 	supplemental_page_table_init(&thread_current()->spt);
 	#endif
 	/* And then load the binary */
-	lock_acquire(&process_lock);
 	success = load (file_name, &_if);
-	lock_release(&process_lock);
 	//hex_dump(_if.rsp , _if.rsp, (USER_STACK-_if.rsp), true);
 	palloc_free_page (file_name);
 	/* If load failed, quit. */
@@ -262,16 +425,16 @@ process_exec (void *f_name) {
 	NOT_REACHED ();
 }
 
+/* Pushes the COUNT arguments in PARSE onto the user stack.  Each entry
+ * of PARSE is replaced by the user address its string was copied to. */
 static void argument_stack(char **parse ,int count ,struct intr_frame *_if){
-	void *arg_addr[LOADER_ARGS_LEN / 2 + 1]; //tmp store phys_addr
-	
 	//stack -> 선 감소, 후 삽입
 	//string
 	for(int i = count-1; i >= 0; i--){ //argv[0][...] ~ argv[(count-1)][...]
 		int arg_len = strlen(parse[i]) + 1; // within '\0'
 		_if->rsp -= arg_len;
 		memcpy(_if->rsp, parse[i], arg_len);
-		arg_addr[i] = (void *)_if->rsp;
+		parse[i] = (char *)_if->rsp;
 	}
 
 	//word-align (1byte)
@@ -288,7 +451,7 @@ static void argument_stack(char **parse ,int count ,struct intr_frame *_if){
 	//phys_addr(addr size 8)
 	for(int i = count-1; i >= 0; i--){
 		_if->rsp -= 8;
-		memcpy(_if->rsp, &arg_addr[i], 8);
+		memcpy(_if->rsp, &parse[i], 8);
 	}
 
 	//main(argc, argv)
@@ -347,11 +510,13 @@ process_exit (void) {
 	 * TODO: Implement process termination message (see
 	 * TODO: project2/process_termination.html).
 	 * TODO: We recommend you to implement process resource cleanup here. */
+	/* Release our frames, text included, while the executable is still
+	 * open with writes denied. */
+	process_cleanup ();
 	//file_allow_write(curr->running_file);
 	file_close(curr->running_file);
-	for(int i=0; i<MAX_FDT; i++){
-		close(i);
-	}
+	fd_table_release(curr->fdt);
+	curr->fdt = NULL;
 
 	
 	if(!list_empty(&curr->child_list)){
@@ -364,7 +529,6 @@ process_exit (void) {
 	
 	sema_up(&curr->wait_sema);
 	sema_down(&curr->succ_sema);
-	process_cleanup ();
 }
 
 /* Free the current process's resources. */
@@ -460,11 +624,47 @@ struct ELF64_PHDR {
 #define ELF ELF64_hdr
 #define Phdr ELF64_PHDR
 
+/* A loadable segment of an executable, as load_segment() wants it. */
+struct exec_segment {
+	uint64_t file_page;             /* Page-aligned offset in the file. */
+	uint64_t mem_page;              /* Page-aligned user virtual address. */
+	uint32_t read_bytes;            /* Bytes to read from the file. */
+	uint32_t zero_bytes;            /* Bytes to zero after them. */
+	bool writable;
+};
+
+/* The parsed layout of an executable.
+ * Executables that are run over and over again only have their ELF
+ * header and program headers read and validated once.  The cache keeps
+ * the inode open, and an image is thrown away as soon as the inode's
+ * generation shows that the file was written or removed since; removing
+ * a file purges the cache right away, so that a removed executable does
+ * not keep its blocks allocated. */
+struct exec_image {
+	struct list_elem elem;          /* Element in exec_cache. */
+	struct inode *inode;            /* Executable, held open while cached. */
+	unsigned generation;            /* Inode generation when parsed. */
+	int ref_cnt;                    /* Cache reference plus loaders. */
+	uint64_t entry;                 /* Entry point. */
+	int seg_cnt;                    /* Number of loadable segments. */
+	struct exec_segment segs[];
+};
+
+/* Maximum number of executables kept in the cache. */
+#define EXEC_CACHE_MAX 16
+
+static struct list exec_cache;      /* Most recently used first. */
+static struct lock exec_cache_lock;
+
 static bool setup_stack (struct intr_frame *if_);
 static bool validate_segment (const struct Phdr *, struct file *);
 static bool load_segment (struct file *file, off_t ofs, uint8_t *upage,
 		uint32_t read_bytes, uint32_t zero_bytes,
 		bool writable);
+static struct exec_image *exec_image_get (struct file *, const char *);
+static struct exec_image *exec_image_parse (struct file *, const char *);
+static void exec_image_put (struct exec_image *);
+static struct exec_image *exec_cache_find (struct inode *);
 
 /* Loads an ELF executable from FILE_NAME into the current thread.
  * Stores the executable's entry point into *RIP
@@ -473,17 +673,21 @@ static bool load_segment (struct file *file, off_t ofs, uint8_t *upage,
 static bool
 load (const char *file_name, struct intr_frame *if_) {
 	struct thread *t = thread_current ();
-	struct ELF ehdr;
+	struct exec_image *image = NULL;
 	struct file *file = NULL;
-	off_t file_ofs;
 	bool success = false;
 	int i;
 	
 	/*let's parsing*/
-	static char *argv[LOADER_ARGS_LEN / 2 + 1];
+	/* Every argument takes at least two bytes of FILE_NAME, so this is
+	 * enough room; each exec parses into its own array. */
+	char **argv = malloc ((strlen (file_name) / 2 + 1) * sizeof *argv);
 	char *token, *save_ptr;
 	int argc = 0;
 
+	if (argv == NULL)
+		return false;
+
 	//char *strtok_r(char *s, const char *delimiters, char **saveptr);
 	for (token = strtok_r (file_name, " ", &save_ptr); token != NULL; token = strtok_r (NULL, " ", &save_ptr)){
 		argv[argc] = token;
@@ -497,6 +701,8 @@ load (const char *file_name, struct intr_frame *if_) {
 	/* Open executable file. */
 	lock_acquire(&filesys_lock);
 	file = filesys_open (file_name);
+	if (file != NULL)
+		file_deny_write(file);
 	lock_release(&filesys_lock);
 	if (file == NULL) {
 		printf ("load: %s: open failed\n", file_name);
@@ -504,9 +710,158 @@ load (const char *file_name, struct intr_frame *if_) {
 	}
 
 	t->running_file = file;
-	file_deny_write(file);
+
+	/* Look up or parse the segment layout. */
+	image = exec_image_get (file, file_name);
+	if (image == NULL)
+		goto done;
+
+	for (i = 0; i < image->seg_cnt; i++) {
+		const struct exec_segment *seg = &image->segs[i];
+
+		if (!load_segment (file, seg->file_page, (void *) seg->mem_page,
+					seg->read_bytes, seg->zero_bytes, seg->writable))
+			goto done;
+	}
+	
+	/* Set up stack. */
+	if (!setup_stack (if_))
+		goto done;
+	
+	/* Start address. */
+	if_->rip = image->entry;
+
+	//void argument_stack(char **parse ,int count ,struct intr_frame *if) struct intr_frame로 변경
+	argument_stack(argv, argc, if_);
+	
+	success = true;
+
+done:
+	/* We arrive here whether the load is successful or not. */
+	//file_close (file);
+	if (image != NULL)
+		exec_image_put (image);
+	free (argv);
+	
+	return success;
+}
+
+static void
+exec_cache_init (void) {
+	list_init (&exec_cache);
+	lock_init (&exec_cache_lock);
+}
+
+/* Returns the layout of executable FILE, named FILE_NAME, with a
+ * reference held for the caller, or a null pointer if FILE is not a
+ * valid executable.  Release the reference with exec_image_put(). */
+static struct exec_image *
+exec_image_get (struct file *file, const char *file_name) {
+	struct inode *inode = file_get_inode (file);
+	struct exec_image *image, *cached, *victim = NULL;
+
+	lock_acquire (&exec_cache_lock);
+	image = exec_cache_find (inode);
+	lock_release (&exec_cache_lock);
+	if (image != NULL)
+		return image;
+	process_exec_cache_purge ();
+
+	image = exec_image_parse (file, file_name);
+	if (image == NULL)
+		return NULL;
+
+	lock_acquire (&filesys_lock);
+	image->inode = inode_reopen (inode);
+	lock_release (&filesys_lock);
+
+	/* Another loader may have parsed the same file meanwhile. */
+	lock_acquire (&exec_cache_lock);
+	cached = exec_cache_find (inode);
+	if (cached == NULL) {
+		image->ref_cnt = 2;
+		list_push_front (&exec_cache, &image->elem);
+		if (list_size (&exec_cache) > EXEC_CACHE_MAX)
+			victim = list_entry (list_pop_back (&exec_cache),
+					struct exec_image, elem);
+	}
+	lock_release (&exec_cache_lock);
+
+	if (victim != NULL)
+		exec_image_put (victim);
+	if (cached == NULL)
+		return image;
+	image->ref_cnt = 1;
+	exec_image_put (image);
+	return cached;
+}
+
+/* Returns the up-to-date cached layout of INODE with a reference taken
+ * for the caller, moving it to the front of the cache, or a null pointer
+ * if there is none.  Must be called with exec_cache_lock held. */
+static struct exec_image *
+exec_cache_find (struct inode *inode) {
+	struct list_elem *e;
+
+	ASSERT (lock_held_by_current_thread (&exec_cache_lock));
+
+	for (e = list_begin (&exec_cache); e != list_end (&exec_cache);
+			e = list_next (e)) {
+		struct exec_image *image = list_entry (e, struct exec_image, elem);
+
+		if (image->inode == inode
+				&& image->generation == inode_get_generation (inode)) {
+			list_remove (&image->elem);
+			list_push_front (&exec_cache, &image->elem);
+			image->ref_cnt++;
+			return image;
+		}
+	}
+	return NULL;
+}
+
+/* Drops every cached layout whose executable was written or removed
+ * since it was parsed, closing its inode once no loader uses it. */
+void
+process_exec_cache_purge (void) {
+	struct list stale;
+	struct list_elem *e, *next;
+
+	list_init (&stale);
+	lock_acquire (&exec_cache_lock);
+	for (e = list_begin (&exec_cache); e != list_end (&exec_cache); e = next) {
+		struct exec_image *image = list_entry (e, struct exec_image, elem);
+
+		next = list_next (e);
+		if (image->generation != inode_get_generation (image->inode)) {
+			list_remove (&image->elem);
+			list_push_back (&stale, &image->elem);
+		}
+	}
+	lock_release (&exec_cache_lock);
+
+	while (!list_empty (&stale))
+		exec_image_put (list_entry (list_pop_front (&stale),
+					struct exec_image, elem));
+}
+
+/* Reads and validates the ELF header and program headers of FILE, named
+ * FILE_NAME, and returns the resulting layout, or a null pointer if FILE
+ * is not a valid executable or memory is short. */
+static struct exec_image *
+exec_image_parse (struct file *file, const char *file_name) {
+	struct inode *inode = file_get_inode (file);
+	struct exec_image *image;
+	struct ELF ehdr;
+	off_t file_ofs;
+	unsigned generation;
+	int i;
+
+	lock_acquire (&filesys_lock);
 
 	/* Read and verify executable header. */
+	generation = inode_get_generation (inode);
+	file_seek (file, 0);
 	if (file_read (file, &ehdr, sizeof ehdr) != sizeof ehdr
 			|| memcmp (ehdr.e_ident, "\177ELF\2\1\1", 7)
 			|| ehdr.e_type != 2
@@ -515,21 +870,30 @@ load (const char *file_name, struct intr_frame *if_) {
 			|| ehdr.e_phentsize != sizeof (struct Phdr)
 			|| ehdr.e_phnum > 1024) {
 		printf ("load: %s: error loading executable\n", file_name);
-		goto done;
+		lock_release (&filesys_lock);
+		return NULL;
 	}
 
-	
+	image = malloc (sizeof *image + ehdr.e_phnum * sizeof *image->segs);
+	if (image == NULL) {
+		lock_release (&filesys_lock);
+		return NULL;
+	}
+	image->generation = generation;
+	image->entry = ehdr.e_entry;
+	image->seg_cnt = 0;
+
 	/* Read program headers. */
 	file_ofs = ehdr.e_phoff;
 	for (i = 0; i < ehdr.e_phnum; i++) {
 		struct Phdr phdr;
 
 		if (file_ofs < 0 || file_ofs > file_length (file))
-			goto done;
+			goto error;
 		file_seek (file, file_ofs);
 
 		if (file_read (file, &phdr, sizeof phdr) != sizeof phdr)
-			goto done;
+			goto error;
 		file_ofs += sizeof phdr;
 		
 		switch (phdr.p_type) {
@@ -543,55 +907,60 @@ load (const char *file_name, struct intr_frame *if_) {
 			case PT_DYNAMIC:
 			case PT_INTERP:
 			case PT_SHLIB:
-				goto done;
+				goto error;
 			case PT_LOAD:
 				if (validate_segment (&phdr, file)) {
-					bool writable = (phdr.p_flags & PF_W) != 0;
-					uint64_t file_page = phdr.p_offset & ~PGMASK;
-					uint64_t mem_page = phdr.p_vaddr & ~PGMASK;
+					struct exec_segment *seg = &image->segs[image->seg_cnt++];
 					uint64_t page_offset = phdr.p_vaddr & PGMASK;
-					uint32_t read_bytes, zero_bytes;
+
+					seg->writable = (phdr.p_flags & PF_W) != 0;
+					seg->file_page = phdr.p_offset & ~PGMASK;
+					seg->mem_page = phdr.p_vaddr & ~PGMASK;
 					if (phdr.p_filesz > 0) {
 						/* Normal segment.
 						 * Read initial part from disk and zero the rest. */
-						read_bytes = page_offset + phdr.p_filesz;
-						zero_bytes = (ROUND_UP (page_offset + phdr.p_memsz, PGSIZE)
-								- read_bytes);
+						seg->read_bytes = page_offset + phdr.p_filesz;
+						seg->zero_bytes = (ROUND_UP (page_offset + phdr.p_memsz, PGSIZE)
+								- seg->read_bytes);
 					} else {
 						/* Entirely zero.
 						 * Don't read anything from disk. */
-						read_bytes = 0;
-						zero_bytes = ROUND_UP (page_offset + phdr.p_memsz, PGSIZE);
+						seg->read_bytes = 0;
+						seg->zero_bytes = ROUND_UP (page_offset + phdr.p_memsz, PGSIZE);
 					}
-					if (!load_segment (file, file_page, (void *) mem_page,
-								read_bytes, zero_bytes, writable))
-						goto done;
 				}
 				else
-					goto done;
+					goto error;
 				break;
 		}
 	}
-	
-	/* Set up stack. */
-	if (!setup_stack (if_))
-		goto done;
-	
-	/* Start address. */
-	if_->rip = ehdr.e_entry;
-
-	//void argument_stack(char **parse ,int count ,struct intr_frame *if) struct intr_frame로 변경
-	argument_stack(argv, argc, if_);
-	
-	success = true;
+	lock_release (&filesys_lock);
+	return image;
 
-done:
-	/* We arrive here whether the load is successful or not. */
-	//file_close (file);
-	
-	return success;
+error:
+	lock_release (&filesys_lock);
+	free (image);
+	return NULL;
 }
 
+/* Drops a reference to IMAGE, freeing it with the last one.
+ * An image that is no longer in exec_cache only has loader references
+ * left, so the last loader frees it. */
+static void
+exec_image_put (struct exec_image *image) {
+	bool last;
+
+	lock_acquire (&exec_cache_lock);
+	last = --image->ref_cnt == 0;
+	lock_release (&exec_cache_lock);
+
+	if (last) {
+		lock_acquire (&filesys_lock);
+		inode_close (image->inode);
+		lock_release (&filesys_lock);
+		free (image);
+	}
+}
 
 /* Checks whether PHDR describes a valid, loadable segment in
  * FILE and returns true if so, false otherwise. */
@@ -1,5 +1,7 @@
 #include "userprog/syscall.h"
+#include <limits.h>
 #include <stdio.h>
+#include <string.h>
 #include <syscall-nr.h>
 #include "threads/interrupt.h"
 #include "threads/thread.h"
@@ -10,9 +12,11 @@
 
 #include "userprog/process.h"
 #include "threads/palloc.h"
+#include "threads/malloc.h"
 #include "filesys/filesys.h"
 #include "filesys/file.h"
 #include <devices/input.h>
+#include "devices/tty.h"
 
 void syscall_entry (void);
 void syscall_handler (struct intr_frame *);
@@ -33,6 +37,7 @@ void syscall_handler (struct intr_frame *);
 void
 syscall_init (void) {
 	lock_init(&filesys_lock);
+	lock_set_name(&filesys_lock, "filesys");
 	write_msr(MSR_STAR, ((uint64_t)SEL_UCSEG - 0x10) << 48  |
 			((uint64_t)SEL_KCSEG) << 32);
 	write_msr(MSR_LSTAR, (uint64_t) syscall_entry);
@@ -140,6 +145,57 @@ syscall_handler (struct intr_frame *f UNUSED) {
 	 	/* return void */
 	 	close(f->R.rdi);
 	 	break;
+
+	case SYS_SCHEDSTAT:
+	 	/* return bool */
+	 	f->R.rax = schedstat((pid_t) f->R.rdi, (struct schedstat *) f->R.rsi);
+	 	break;
+
+	case SYS_SPAWN:
+	 	/* return pid_t */
+	 	f->R.rax = spawn((const char *) f->R.rdi,
+				(const struct spawn_action *) f->R.rsi, (int) f->R.rdx);
+	 	break;
+
+	case SYS_READV:
+	 	/* return int */
+	 	f->R.rax = readv((int) f->R.rdi, (const struct iovec *) f->R.rsi,
+				(int) f->R.rdx);
+	 	break;
+
+	case SYS_WRITEV:
+	 	/* return int */
+	 	f->R.rax = writev((int) f->R.rdi, (const struct iovec *) f->R.rsi,
+				(int) f->R.rdx);
+	 	break;
+
+	case SYS_PREAD:
+	 	/* return int */
+	 	f->R.rax = pread((int) f->R.rdi, (void *) f->R.rsi,
+				(unsigned) f->R.rdx, (off_t) f->R.r10);
+	 	break;
+
+	case SYS_PWRITE:
+	 	/* return int */
+	 	f->R.rax = pwrite((int) f->R.rdi, (const void *) f->R.rsi,
+				(unsigned) f->R.rdx, (off_t) f->R.r10);
+	 	break;
+
+	case SYS_SENDFILE:
+	 	/* return int */
+	 	f->R.rax = sendfile((int) f->R.rdi, (int) f->R.rsi,
+				(off_t *) f->R.rdx, (unsigned) f->R.r10);
+	 	break;
+
+	case SYS_URING_ENTER:
+	 	/* return int */
+	 	f->R.rax = uring_enter((struct uring *) f->R.rdi, (unsigned) f->R.rsi);
+	 	break;
+
+	case SYS_TTYMODE:
+	 	/* return int */
+	 	f->R.rax = ttymode(f->R.rdi);
+	 	break;
 	
 	default:
 		thread_exit();
@@ -201,8 +257,13 @@ create (const char *file, unsigned initial_size) {
 
 bool
 remove (const char *file) {
+	bool success;
+
 	check_address(file);
-	return filesys_remove(file);
+	success = filesys_remove(file);
+	if (success)
+		process_exec_cache_purge ();
+	return success;
 }
 
 int
@@ -210,21 +271,23 @@ open (const char *file) {
 	if (!file){
 		exit(-1);
 	}
-	lock_acquire(&filesys_lock);
 	int fd;
 	check_address(file);
+	lock_acquire(&filesys_lock);
 	struct file *curr_file = filesys_open(file);
-	if(!curr_file){
-		lock_release(&filesys_lock);
+	lock_release(&filesys_lock);
+	if(!curr_file)
 		return -1;
-	}	
 
+	/* The descriptor table takes filesys_lock itself if it has to
+	 * duplicate files to unshare. */
 	fd = process_add_file(curr_file);
 
 	if(fd == -1){
+		lock_acquire(&filesys_lock);
 		file_close(curr_file);
+		lock_release(&filesys_lock);
 	}
-	lock_release(&filesys_lock);
 	return fd;
 }
 
@@ -240,34 +303,18 @@ filesize (int fd) {
 int
 read (int fd, void *buffer, unsigned size) {
 	check_valid_buffer(buffer, size, true);
-	lock_acquire(&filesys_lock);
-	if(fd == 1){
-		lock_release(&filesys_lock);
-		return -1;
-	}
-	char *str_buffer = (char *)buffer;
+	/* The console goes through the line discipline, which never needs
+	 * the file system lock. */
+	if(process_is_console(fd))
+		return fd == 0 ? tty_read(buffer, size) : -1;
+
 	int result = 0;
 	struct file *curr_file = process_get_file(fd);
-	
-	if(!curr_file){
-		lock_release(&filesys_lock);
+	if(!curr_file)
 		return -1;
-	}
-
-	if(fd == 0){
-		while(1){
-			char input_char = input_getc();
-			str_buffer[result] = input_char;
-			result++;
-			if(input_char == '\0'){
-				break;
-			}
-		}
-	} else {
-		result = file_read(curr_file, buffer, size);
-	}
-	
 
+	lock_acquire(&filesys_lock);
+	result = file_read(curr_file, buffer, size);
 	lock_release(&filesys_lock);
 	return result;
 }
@@ -275,26 +322,21 @@ read (int fd, void *buffer, unsigned size) {
 int
 write (int fd, const void *buffer, unsigned size) {
 	check_valid_buffer(buffer, size, false);
-	lock_acquire(&filesys_lock);
+	/* The console never needs the descriptor table or the lock. */
+	if(process_is_console(fd)){
+		if(fd == 0)
+			return -1;
+		putbuf(buffer, size);
+		return size;
+	}
 
 	int result;
 	struct file *curr_file = process_get_file(fd);
-	if(fd == 0){
-		lock_release(&filesys_lock);
+	if(curr_file == NULL)
 		return -1;
-	}
 
-	if(fd == 1){
-		putbuf(buffer, size);
-		result = size;
-	}else {
-		if(curr_file == NULL){
-			lock_release(&filesys_lock);
-			return -1;
-		}
-		result = file_write(curr_file, buffer, size);
-	}
-	
+	lock_acquire(&filesys_lock);
+	result = file_write(curr_file, buffer, size);
 	lock_release(&filesys_lock);
 	return result;
 }
@@ -312,17 +354,15 @@ tell (int fd) {
 
 void
 close (int fd) {
-	if (fd < 2 || fd >= MAX_FDT)
-        return NULL;
-
-	struct file *curr_file = process_get_file(fd);
+	struct file *curr_file = process_remove_file(fd);
 	if(!curr_file)
 		return;
 	
-	thread_current()->fdt[fd] = NULL;
 	if (thread_current()->running_file == curr_file)
 		thread_current()->running_file = NULL;
+	lock_acquire(&filesys_lock);
 	file_close(curr_file);
+	lock_release(&filesys_lock);
 }
 /*
 
@@ -335,9 +375,317 @@ dup2 (int oldfd, int newfd){
 */
 //-----------extra-----------------------------
 
-struct page *check_address(void *addr){
+bool
+schedstat (pid_t pid, struct schedstat *st) {
+	struct schedstat copy;
+
+	check_valid_buffer(st, sizeof *st, true);
+	if (!thread_get_schedstat(pid, &copy))
+		return false;
+	*st = copy;
+	return true;
+}
+
+pid_t
+spawn (const char *cmd_line, const struct spawn_action *actions,
+		int action_cnt) {
+	struct spawn_action *copy = NULL;
+	char *fn_copy;
+	pid_t pid;
+
+	check_address(cmd_line);
+	if (action_cnt < 0 || action_cnt > SPAWN_ACTIONS_MAX)
+		return PID_ERROR;
+	if (action_cnt > 0) {
+		check_valid_buffer(actions, action_cnt * sizeof *actions, false);
+		copy = malloc(action_cnt * sizeof *copy);
+		if (copy == NULL)
+			return PID_ERROR;
+		memcpy(copy, actions, action_cnt * sizeof *copy);
+	}
+
+	fn_copy = palloc_get_page (0);
+	if (fn_copy == NULL) {
+		free(copy);
+		return PID_ERROR;
+	}
+	strlcpy(fn_copy, cmd_line, PGSIZE);
+
+	pid = process_spawn(fn_copy, copy, action_cnt);
+	free(copy);
+	return pid;
+}
+
+/* Copies the IOVCNT entries of user array IOV into KIOV, checking every
+ * buffer they describe.  IS_READ is true if the buffers will be written
+ * to.  Returns the total length, or -1 if IOVCNT is out of range. */
+static int
+copy_in_iovec (struct iovec *kiov, const struct iovec *iov, int iovcnt,
+		bool is_read) {
+	size_t total = 0;
+
+	if (iovcnt <= 0 || iovcnt > IOV_MAX)
+		return -1;
+	check_valid_buffer(iov, iovcnt * sizeof *iov, false);
+	memcpy(kiov, iov, iovcnt * sizeof *iov);
+
+	for (int i = 0; i < iovcnt; i++) {
+		if (kiov[i].iov_len == 0)
+			continue;
+		check_valid_buffer(kiov[i].iov_base, kiov[i].iov_len, is_read);
+		total += kiov[i].iov_len;
+		if (total > INT32_MAX)
+			return -1;
+	}
+	return total;
+}
+
+/* Reads from FD into the IOVCNT buffers of IOV in order, starting at
+ * the file's current position, as a single read(). */
+int
+readv (int fd, const struct iovec *iov, int iovcnt) {
+	struct iovec *kiov = malloc(IOV_MAX * sizeof *kiov);
+	struct file *curr_file;
+	int result = 0;
+	off_t pos;
+
+	if (kiov == NULL)
+		return -1;
+	if (copy_in_iovec(kiov, iov, iovcnt, true) < 0
+			|| (curr_file = process_get_file(fd)) == NULL) {
+		free(kiov);
+		return -1;
+	}
+
+	lock_acquire(&filesys_lock);
+	pos = file_tell(curr_file);
+	for (int i = 0; i < iovcnt; i++) {
+		off_t n = file_read_at(curr_file, kiov[i].iov_base, kiov[i].iov_len,
+				pos + result);
+		result += n;
+		if (n < (off_t) kiov[i].iov_len)
+			break;
+	}
+	file_seek(curr_file, pos + result);
+	lock_release(&filesys_lock);
+
+	free(kiov);
+	return result;
+}
+
+/* Writes the IOVCNT buffers of IOV to FD in order, at the file's
+ * current position, as a single write(). */
+int
+writev (int fd, const struct iovec *iov, int iovcnt) {
+	struct iovec *kiov = malloc(IOV_MAX * sizeof *kiov);
+	struct file *curr_file = NULL;
+	bool console = fd == 1 && process_is_console(fd);
+	int result = 0;
+	off_t pos;
+
+	if (kiov == NULL)
+		return -1;
+	if (copy_in_iovec(kiov, iov, iovcnt, false) < 0
+			|| (!console && (curr_file = process_get_file(fd)) == NULL)) {
+		free(kiov);
+		return -1;
+	}
+
+	if (console) {
+		for (int i = 0; i < iovcnt; i++) {
+			putbuf(kiov[i].iov_base, kiov[i].iov_len);
+			result += kiov[i].iov_len;
+		}
+		free(kiov);
+		return result;
+	}
+
+	lock_acquire(&filesys_lock);
+	pos = file_tell(curr_file);
+	for (int i = 0; i < iovcnt; i++) {
+		off_t n = file_write_at(curr_file, kiov[i].iov_base, kiov[i].iov_len,
+				pos + result);
+		result += n;
+		if (n < (off_t) kiov[i].iov_len)
+			break;
+	}
+	file_seek(curr_file, pos + result);
+	lock_release(&filesys_lock);
+
+	free(kiov);
+	return result;
+}
+
+/* Reads SIZE bytes from FD at OFFSET into BUFFER.  The file position is
+ * neither used nor changed, so concurrent readers do not race on it. */
+int
+pread (int fd, void *buffer, unsigned size, off_t offset) {
+	struct file *curr_file;
+	int result;
+
+	check_valid_buffer(buffer, size, true);
+	if (offset < 0)
+		return -1;
+	curr_file = process_get_file(fd);
+	if (curr_file == NULL)
+		return -1;
+
+	lock_acquire(&filesys_lock);
+	result = file_read_at(curr_file, buffer, size, offset);
+	lock_release(&filesys_lock);
+	return result;
+}
+
+/* Writes SIZE bytes from BUFFER to FD at OFFSET, without using or
+ * changing the file position. */
+int
+pwrite (int fd, const void *buffer, unsigned size, off_t offset) {
+	struct file *curr_file;
+	int result;
+
+	check_valid_buffer(buffer, size, false);
+	if (offset < 0)
+		return -1;
+	curr_file = process_get_file(fd);
+	if (curr_file == NULL)
+		return -1;
+
+	lock_acquire(&filesys_lock);
+	result = file_write_at(curr_file, buffer, size, offset);
+	lock_release(&filesys_lock);
+	return result;
+}
+
+/* Copies up to COUNT bytes from IN_FD to OUT_FD inside the kernel,
+ * through one page-sized buffer, without touching user memory.
+ * If OFFSET is null, reading starts at IN_FD's position, which is
+ * advanced.  Otherwise reading starts at *OFFSET, which is updated, and
+ * IN_FD's position is left alone.  OUT_FD is written at its position, or
+ * to the console if it is 1 and not redirected.  Returns the number of
+ * bytes copied, which is why at most INT_MAX bytes are copied per call. */
+int
+sendfile (int out_fd, int in_fd, off_t *offset, unsigned count) {
+	struct file *in_file, *out_file = NULL;
+	off_t in_pos, out_pos = 0;
+	int result = 0;
+	uint8_t *buffer;
+
+	if (offset != NULL)
+		check_valid_buffer(offset, sizeof *offset, true);
+	in_file = process_get_file(in_fd);
+	if (in_file == NULL || (!(out_fd == 1 && process_is_console(out_fd))
+				&& (out_file = process_get_file(out_fd)) == NULL))
+		return -1;
+	in_pos = offset != NULL ? *offset : file_tell(in_file);
+	if (in_pos < 0)
+		return -1;
+	if (count > INT_MAX)
+		count = INT_MAX;
+
+	buffer = palloc_get_page(0);
+	if (buffer == NULL)
+		return -1;
+
+	lock_acquire(&filesys_lock);
+	if (out_file != NULL)
+		out_pos = file_tell(out_file);
+	while (count > 0) {
+		off_t chunk = count < PGSIZE ? count : PGSIZE;
+		off_t n = file_read_at(in_file, buffer, chunk, in_pos);
+
+		if (n <= 0)
+			break;
+		if (out_file == NULL)
+			putbuf((const char *) buffer, n);
+		else {
+			n = file_write_at(out_file, buffer, n, out_pos);
+			out_pos += n;
+		}
+		if (n <= 0)
+			break;
+
+		in_pos += n;
+		count -= n;
+		result += n;
+		if (n < chunk)
+			break;
+	}
+	if (out_file != NULL)
+		file_seek(out_file, out_pos);
+	if (offset == NULL)
+		file_seek(in_file, in_pos);
+	lock_release(&filesys_lock);
+	palloc_free_page(buffer);
+
+	if (offset != NULL)
+		*offset = in_pos;
+	return result;
+}
+
+/* Carries out one ring submission SQE and returns its result. */
+static int64_t
+uring_do (const struct uring_sqe *sqe) {
+	void *addr = (void *) sqe->addr;
+
+	switch (sqe->opcode) {
+	case URING_OP_NOP:
+		return 0;
+	case URING_OP_READ:
+		return sqe->off < 0 ? read(sqe->fd, addr, sqe->len)
+			: pread(sqe->fd, addr, sqe->len, sqe->off);
+	case URING_OP_WRITE:
+		return sqe->off < 0 ? write(sqe->fd, addr, sqe->len)
+			: pwrite(sqe->fd, addr, sqe->len, sqe->off);
+	case URING_OP_OPEN:
+		return open(addr);
+	case URING_OP_CLOSE:
+		close(sqe->fd);
+		return 0;
+	default:
+		return -1;
+	}
+}
+
+/* Carries out up to TO_SUBMIT entries queued in the submission queue of
+ * RING, posting a completion for each, all in a single trap.  Stops
+ * early if the completion queue fills up.  Returns the number of entries
+ * consumed, or -1 if the ring's indices are inconsistent. */
+int
+uring_enter (struct uring *ring, unsigned to_submit) {
+	uint32_t sq_head, sq_tail, cq_tail;
+	int submitted = 0;
+
+	check_valid_buffer(ring, sizeof *ring, true);
+	sq_head = ring->sq_head;
+	sq_tail = ring->sq_tail;
+	cq_tail = ring->cq_tail;
+	if (sq_tail - sq_head > URING_ENTRIES
+			|| cq_tail - ring->cq_head > URING_ENTRIES)
+		return -1;
+
+	while (sq_head != sq_tail && (unsigned) submitted < to_submit
+			&& cq_tail - ring->cq_head < URING_ENTRIES) {
+		struct uring_sqe sqe = ring->sqes[sq_head % URING_ENTRIES];
+		struct uring_cqe *cqe = &ring->cqes[cq_tail % URING_ENTRIES];
+
+		cqe->res = uring_do(&sqe);
+		cqe->user_data = sqe.user_data;
+		ring->sq_head = ++sq_head;
+		ring->cq_tail = ++cq_tail;
+		submitted++;
+	}
+	return submitted;
+}
+
+/* Sets the console input mode and returns the previous one. */
+int
+ttymode (int mode) {
+	return tty_set_mode(mode);
+}
+
+struct page *check_address(const void *addr){
 #ifdef VM
-	struct page *page = spt_find_page(&thread_current()->spt, addr);
+	struct page *page = spt_find_page(&thread_current()->spt, (void *) addr);
 
 	if (!addr || !(is_user_vaddr(addr)) || !page) {
 		exit(-1);
@@ -352,9 +700,21 @@ struct page *check_address(void *addr){
 #endif
 }
 
-void check_valid_buffer (void *buffer, unsigned size, bool is_read) {
-	for (char i = 0; i < size; i++) {
-		struct page *page = check_address(buffer + i);
+/* Checks that the SIZE bytes at user address BUFFER are mapped, and
+ * writable if IS_READ, killing the process otherwise.  Only one lookup
+ * is done per page spanned by the buffer. */
+void check_valid_buffer (const void *buffer, unsigned size, bool is_read) {
+	const uint8_t *upage, *last;
+
+	if (size == 0)
+		return;
+	last = (const uint8_t *) buffer + size - 1;
+	if (last < (const uint8_t *) buffer)
+		exit(-1);
+
+	for (upage = pg_round_down(buffer); upage <= (const uint8_t *) pg_round_down(last);
+			upage += PGSIZE) {
+		struct page *page = check_address(upage);
 		
 		if (is_read && !page->writable) {
 			exit(-1);
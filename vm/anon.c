@@ -1,7 +1,10 @@
 /* anon.c: Implementation of page for non-disk image (a.k.a. anonymous page). */
 
 #include "vm/vm.h"
+#include <string.h>
+#include "vm/zswap.h"
 #include "devices/disk.h"
+#include "threads/malloc.h"
 #include "include/lib/kernel/bitmap.h"
 
 /* DO NOT MODIFY BELOW LINE */
@@ -28,6 +31,7 @@ vm_anon_init (void) {
 	swap_disk = disk_get(1, 1);
 	size_t swap_size = disk_size(swap_disk)/ SECTORS_PER_PAGE;
 	swap_table = bitmap_create(swap_size);
+	zswap_init ();
 }
 
 /* Initialize the file mapping */
@@ -41,6 +45,7 @@ anon_initializer (struct page *page, enum vm_type type, void *kva) {
 
     struct anon_page *anon_page = &page->anon;
     anon_page->swap_index = -1;
+    anon_page->zswap = NULL;
 	
 	return true;
 }
@@ -50,39 +55,64 @@ static bool
 anon_swap_in (struct page *page, void *kva) {
 	struct anon_page *anon_page = &page->anon;
 	
-	int page_no = anon_page->swap_index;
-	bool result = bitmap_test(swap_table, page_no);
+	if (anon_page->zswap != NULL)
+		return zswap_load (page, kva);
 
-	if(result == false)
+	int page_no = anon_page->swap_index;
+	if (page_no < 0 || !swap_slot_read (page_no, kva))
 		return false;
 
-	for(int i =0; i<SECTORS_PER_PAGE; ++i)
-		disk_read(swap_disk, page_no*SECTORS_PER_PAGE+i, kva+DISK_SECTOR_SIZE*i);
-
-	bitmap_set(swap_table, page_no, false);
-
+	anon_page->swap_index = -1;
 	return true;
 }
 
-/* Swap out the page by writing contents to the swap disk. */
+/* Swap out the page by writing contents to the swap disk.
+ * The page is first offered to the compressed swap cache; only pages
+ * that do not compress well go straight to the disk. */
 static bool
 anon_swap_out (struct page *page) {
 	struct anon_page *anon_page = &page->anon;
+	void *kva = page->frame->kva;
 	
-	int page_no = bitmap_scan(swap_table, 0, 1, false);
+	if (!zswap_store (page, kva)) {
+		int page_no = swap_slot_write (kva);
+		if (page_no < 0)
+			return false;
+		anon_page->swap_index = page_no;
+	}
 
-	if(page_no = BITMAP_ERROR)
-		return false;
-	
-	for(int i=0; i< SECTORS_PER_PAGE; ++i)
-		disk_write(swap_disk, page_no*DISK_SECTOR_SIZE+i, page->va+DISK_SECTOR_SIZE*i);
+	pml4_clear_page(page->owner->pml4, page->va);
+
+	return true;
+}
+
+/* Writes the page at KVA to a free swap slot.
+ * Returns the slot number, or -1 if the swap disk is full. */
+int
+swap_slot_write (const void *kva) {
+	size_t page_no = bitmap_scan_and_flip (swap_table, 0, 1, false);
+
+	if (page_no == BITMAP_ERROR)
+		return -1;
 	
-	bitmap_set(swap_table, page_no, true);
+	for (size_t i = 0; i < SECTORS_PER_PAGE; ++i)
+		disk_write (swap_disk, page_no * SECTORS_PER_PAGE + i,
+				kva + DISK_SECTOR_SIZE * i);
+
+	return page_no;
+}
 
-	pml4_clear_page(thread_current()->pml4, page->va);
+/* Reads swap slot PAGE_NO into KVA and frees the slot. */
+bool
+swap_slot_read (int page_no, void *kva) {
+	if (!bitmap_test (swap_table, page_no))
+		return false;
 
-	anon_page->swap_index = page_no;
+	for (size_t i = 0; i < SECTORS_PER_PAGE; ++i)
+		disk_read (swap_disk, page_no * SECTORS_PER_PAGE + i,
+				kva + DISK_SECTOR_SIZE * i);
 
+	bitmap_set (swap_table, page_no, false);
 	return true;
 }
 
@@ -90,5 +120,10 @@ anon_swap_out (struct page *page) {
 static void
 anon_destroy (struct page *page) {
 	struct anon_page *anon_page = &page->anon;
+
+	if (anon_page->zswap != NULL)
+		zswap_invalidate (page);
+	else if (anon_page->swap_index >= 0)
+		bitmap_set (swap_table, anon_page->swap_index, false);
 	free(page->frame);
 }
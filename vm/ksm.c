@@ -0,0 +1,251 @@
+/* ksm.c: Same-page merging of anonymous frames.
+ *
+ * The ksmd kernel thread periodically hashes the contents of every
+ * anonymous frame in the frame table.  Frames whose contents turn out to
+ * be identical are merged into a single frame that is mapped read-only in
+ * every owner; the duplicate frames go back to the user pool.  A later
+ * write to a merged page faults and is resolved by vm_handle_wp(), which
+ * hands the writer a private copy again (copy-on-write). */
+
+#include "vm/ksm.h"
+#include <stdio.h>
+#include <string.h>
+#include "devices/timer.h"
+#include "threads/interrupt.h"
+#include "threads/malloc.h"
+#include "threads/mmu.h"
+#include "threads/thread.h"
+
+/* A frame seen during the current scan. */
+struct ksm_node {
+	struct hash_elem sum_elem;      /* Element in the by-checksum table. */
+	struct hash_elem frame_elem;    /* Element in the by-frame table. */
+	uint64_t checksum;
+	struct frame *frame;
+	void *kva;
+	bool live;                      /* Found in the frame table while merging. */
+};
+
+static long long pages_merged;   /* # of merges since boot. */
+static long long pages_saved;    /* # of frames currently saved. */
+
+static void ksm_kthread (void *aux UNUSED);
+static void ksm_scan (void);
+static bool ksm_mergeable (struct frame *frame);
+static bool ksm_merge (struct frame *stable, struct frame *dup);
+static void ksm_write_protect (struct page *page);
+static uint64_t ksm_hash (const struct hash_elem *e, void *aux UNUSED);
+static bool ksm_less (const struct hash_elem *a, const struct hash_elem *b,
+		void *aux UNUSED);
+static uint64_t ksm_frame_hash (const struct hash_elem *e, void *aux UNUSED);
+static bool ksm_frame_less (const struct hash_elem *a,
+		const struct hash_elem *b, void *aux UNUSED);
+
+/* Starts the merging daemon. */
+void
+ksm_init (void) {
+	thread_create ("ksmd", PRI_MIN, ksm_kthread, NULL);
+}
+
+/* Called when PAGE stops sharing its frame, either because of a
+ * copy-on-write fault or because its owner exited.
+ * Must be called with frame_lock held. */
+void
+ksm_unshared (struct page *page) {
+	if (page_get_type (page) == VM_ANON && page->frame->text == NULL
+			&& pages_saved > 0)
+		pages_saved--;
+}
+
+/* Prints merging statistics. */
+void
+ksm_print_stats (void) {
+	printf ("KSM: %lld pages merged, %lld pages saved\n",
+			pages_merged, pages_saved);
+}
+
+static void
+ksm_kthread (void *aux UNUSED) {
+	for (;;) {
+		timer_sleep (KSM_SCAN_TICKS);
+		ksm_scan ();
+	}
+}
+
+/* Scans the frame table once, merging every anonymous frame into the
+ * first frame seen with the same contents.
+ * Hashing 4 kB per frame is the expensive part, so it happens without
+ * frame_lock: the candidates are only recorded under the lock, hashed,
+ * and then looked up again in the frame table, under the lock, to merge
+ * the ones that are still there.  ksm_merge() compares the contents
+ * again, so a checksum gone stale meanwhile only costs a failed merge. */
+static void
+ksm_scan (void) {
+	struct hash by_sum, by_frame;
+	struct ksm_node *nodes;
+	struct list_elem *e, *next;
+	size_t cnt = 0, i;
+
+	/* Record the candidates. */
+	lock_acquire (&frame_lock);
+	nodes = list_empty (&frame_table)
+		? NULL : malloc (list_size (&frame_table) * sizeof *nodes);
+	if (nodes == NULL) {
+		lock_release (&frame_lock);
+		return;
+	}
+	for (e = list_begin (&frame_table); e != list_end (&frame_table);
+			e = list_next (e)) {
+		struct frame *frame = list_entry (e, struct frame, frame_elem);
+
+		if (!ksm_mergeable (frame))
+			continue;
+		nodes[cnt].frame = frame;
+		nodes[cnt].kva = frame->kva;
+		nodes[cnt].live = false;
+		cnt++;
+	}
+	lock_release (&frame_lock);
+
+	if (!hash_init (&by_sum, ksm_hash, ksm_less, NULL)) {
+		free (nodes);
+		return;
+	}
+	if (!hash_init (&by_frame, ksm_frame_hash, ksm_frame_less, NULL)) {
+		hash_destroy (&by_sum, NULL);
+		free (nodes);
+		return;
+	}
+
+	/* Hash them.  A kva freed meanwhile is still mapped in the kernel
+	 * pool, so reading it is harmless. */
+	for (i = 0; i < cnt; i++) {
+		nodes[i].checksum = hash_bytes (nodes[i].kva, PGSIZE);
+		hash_insert (&by_sum, &nodes[i].sum_elem);
+		hash_insert (&by_frame, &nodes[i].frame_elem);
+	}
+
+	/* Merge the candidates that are still in the frame table.  The table
+	 * is walked in the order the candidates were recorded in, so the
+	 * first live frame with a given checksum becomes the stable one. */
+	lock_acquire (&frame_lock);
+	for (e = list_begin (&frame_table); e != list_end (&frame_table); e = next) {
+		struct frame *frame = list_entry (e, struct frame, frame_elem);
+		struct ksm_node key, *node, *stable;
+		struct hash_elem *found;
+
+		next = list_next (e);
+		key.frame = frame;
+		found = hash_find (&by_frame, &key.frame_elem);
+		if (found == NULL)
+			continue;
+		node = hash_entry (found, struct ksm_node, frame_elem);
+		if (node->kva != frame->kva || !ksm_mergeable (frame))
+			continue;
+
+		stable = hash_entry (hash_find (&by_sum, &node->sum_elem),
+				struct ksm_node, sum_elem);
+		if (stable == node || !stable->live) {
+			hash_replace (&by_sum, &node->sum_elem);
+			node->live = true;
+			continue;
+		}
+		if (!ksm_merge (stable->frame, frame))
+			node->live = true;
+	}
+	lock_release (&frame_lock);
+
+	hash_destroy (&by_sum, NULL);
+	hash_destroy (&by_frame, NULL);
+	free (nodes);
+}
+
+/* Returns true if FRAME holds a live anonymous page.  Frames in the text
+ * cache are already shared by construction and must stay where they are,
+ * and frames still being loaded do not hold their contents yet. */
+static bool
+ksm_mergeable (struct frame *frame) {
+	struct page *page = frame->page;
+
+	return page != NULL && frame->ref_cnt > 0 && frame->text == NULL
+		&& !frame->loading
+		&& page->operations->type == VM_ANON
+		&& page->owner != NULL && page->owner->pml4 != NULL;
+}
+
+/* Merges DUP, a singly mapped frame, into STABLE if both still hold the
+ * same bytes.  The comparison and the remapping happen with interrupts
+ * off, so that no owner can write to either frame in between. */
+static bool
+ksm_merge (struct frame *stable, struct frame *dup) {
+	struct page *page = dup->page;
+	enum intr_level old_level;
+	uint64_t *pte;
+	struct list_elem *e;
+
+	if (dup->ref_cnt != 1)
+		return false;
+
+	old_level = intr_disable ();
+	pte = pml4e_walk (page->owner->pml4, (uint64_t) page->va, 0);
+	if (pte == NULL || !(*pte & PTE_P) || PTE_ADDR (*pte) != vtop (dup->kva)
+			|| memcmp (stable->kva, dup->kva, PGSIZE)) {
+		intr_set_level (old_level);
+		return false;
+	}
+
+	*pte = vtop (stable->kva) | PTE_P | PTE_U;
+	pml4_invalidate_page (page->owner->pml4, page->va);
+	list_remove (&page->share_elem);
+	frame_share (stable, page);
+	for (e = list_begin (&stable->sharers); e != list_end (&stable->sharers);
+			e = list_next (e))
+		ksm_write_protect (list_entry (e, struct page, share_elem));
+	intr_set_level (old_level);
+
+	frame_table_remove (dup);
+	palloc_free_page (dup->kva);
+	free (dup);
+
+	pages_merged++;
+	pages_saved++;
+	return true;
+}
+
+/* Clears the write permission of PAGE's mapping. */
+static void
+ksm_write_protect (struct page *page) {
+	uint64_t *pte = pml4e_walk (page->owner->pml4, (uint64_t) page->va, 0);
+	if (pte != NULL) {
+		*pte &= ~(uint64_t) PTE_W;
+		pml4_invalidate_page (page->owner->pml4, page->va);
+	}
+}
+
+static uint64_t
+ksm_hash (const struct hash_elem *e, void *aux UNUSED) {
+	const struct ksm_node *node = hash_entry (e, struct ksm_node, sum_elem);
+	return node->checksum;
+}
+
+static bool
+ksm_less (const struct hash_elem *a, const struct hash_elem *b,
+		void *aux UNUSED) {
+	const struct ksm_node *x = hash_entry (a, struct ksm_node, sum_elem);
+	const struct ksm_node *y = hash_entry (b, struct ksm_node, sum_elem);
+	return x->checksum < y->checksum;
+}
+
+static uint64_t
+ksm_frame_hash (const struct hash_elem *e, void *aux UNUSED) {
+	const struct ksm_node *node = hash_entry (e, struct ksm_node, frame_elem);
+	return hash_bytes (&node->frame, sizeof node->frame);
+}
+
+static bool
+ksm_frame_less (const struct hash_elem *a, const struct hash_elem *b,
+		void *aux UNUSED) {
+	const struct ksm_node *x = hash_entry (a, struct ksm_node, frame_elem);
+	const struct ksm_node *y = hash_entry (b, struct ksm_node, frame_elem);
+	return x->frame < y->frame;
+}
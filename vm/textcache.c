@@ -0,0 +1,154 @@
+/* textcache.c: Sharing of read-only executable pages.
+ *
+ * Every process running the same executable would otherwise read its own
+ * copy of the program text into a private frame.  The text cache remembers
+ * which frame holds the contents of a read-only PT_LOAD page, keyed by the
+ * executable's inode and generation, the page's file offset and the number
+ * of bytes read from the file.  Later faults on the same page of the same
+ * executable, in any process, simply map that frame read-only and take a
+ * reference on it.
+ *
+ * An entry lives exactly as long as its frame: it goes away when the last
+ * page mapping the frame is released or when the frame is evicted.  The
+ * entry keeps the inode open, so that its address cannot be reused by
+ * another executable meanwhile.  Writing the executable changes its
+ * generation, after which the entry no longer matches.
+ *
+ * All functions must be called with frame_lock held. */
+
+#include "vm/textcache.h"
+#include <stdio.h>
+#include "filesys/file.h"
+#include "filesys/inode.h"
+#include "threads/malloc.h"
+#include "userprog/process.h"
+#include "userprog/syscall.h"
+
+/* A frame holding an executable page. */
+struct text_page {
+	struct hash_elem elem;
+	struct text_key key;        /* Contents, with the inode held open. */
+	struct frame *frame;        /* Frame holding the contents. */
+};
+
+static struct hash text_pages;
+
+/* Statistics. */
+static long long hit_cnt;           /* # of faults served from the cache. */
+static long long miss_cnt;          /* # of pages read into the cache. */
+
+static uint64_t text_page_hash (const struct hash_elem *e, void *aux UNUSED);
+static bool text_page_less (const struct hash_elem *a,
+		const struct hash_elem *b, void *aux UNUSED);
+
+void
+text_cache_init (void) {
+	hash_init (&text_pages, text_page_hash, text_page_less, NULL);
+}
+
+/* If PAGE is a not yet loaded page of a read-only segment of an
+ * executable, stores the key of its contents into *KEY and returns true.
+ * Returns false otherwise. */
+bool
+text_cache_key (struct page *page, struct text_key *key) {
+	struct container *container;
+
+	if (VM_TYPE (page->operations->type) != VM_UNINIT || page->writable
+			|| page->uninit.init != lazy_load_segment)
+		return false;
+
+	container = page->uninit.aux;
+	key->inode = file_get_inode (container->file);
+	key->generation = inode_get_generation (key->inode);
+	key->ofs = container->ofs;
+	key->read_bytes = container->read_bytes;
+	return true;
+}
+
+/* Returns the frame holding the executable page KEY, or a null pointer
+ * if no process has it loaded. */
+struct frame *
+text_cache_lookup (const struct text_key *key) {
+	struct text_page tp;
+	struct hash_elem *e;
+
+	ASSERT (lock_held_by_current_thread (&frame_lock));
+
+	tp.key = *key;
+	e = hash_find (&text_pages, &tp.elem);
+	if (e == NULL)
+		return NULL;
+
+	hit_cnt++;
+	return hash_entry (e, struct text_page, elem)->frame;
+}
+
+/* Records that FRAME now holds the executable page KEY.  Does nothing
+ * if another process loaded the same page first. */
+void
+text_cache_insert (struct frame *frame, const struct text_key *key) {
+	struct text_page *tp;
+
+	ASSERT (lock_held_by_current_thread (&frame_lock));
+	ASSERT (frame->text == NULL);
+
+	tp = malloc (sizeof *tp);
+	if (tp == NULL)
+		return;
+	tp->key = *key;
+	tp->frame = frame;
+	if (hash_insert (&text_pages, &tp->elem) != NULL) {
+		free (tp);
+		return;
+	}
+	lock_acquire (&filesys_lock);
+	inode_reopen (tp->key.inode);
+	lock_release (&filesys_lock);
+	frame->text = tp;
+	miss_cnt++;
+}
+
+/* Forgets the cache entry of FRAME, if any, before the frame is freed or
+ * reused for another page. */
+void
+text_cache_remove (struct frame *frame) {
+	ASSERT (lock_held_by_current_thread (&frame_lock));
+
+	if (frame->text == NULL)
+		return;
+	hash_delete (&text_pages, &frame->text->elem);
+	lock_acquire (&filesys_lock);
+	inode_close (frame->text->key.inode);
+	lock_release (&filesys_lock);
+	free (frame->text);
+	frame->text = NULL;
+}
+
+/* Prints text cache statistics. */
+void
+text_cache_print_stats (void) {
+	printf ("Text cache: %zu pages, %lld hits, %lld misses\n",
+			hash_size (&text_pages), hit_cnt, miss_cnt);
+}
+
+static uint64_t
+text_page_hash (const struct hash_elem *e, void *aux UNUSED) {
+	const struct text_key *k = &hash_entry (e, struct text_page, elem)->key;
+	return hash_bytes (&k->inode, sizeof k->inode) ^ hash_int (k->generation)
+		^ hash_int (k->ofs) ^ hash_int (k->read_bytes);
+}
+
+static bool
+text_page_less (const struct hash_elem *a, const struct hash_elem *b,
+		void *aux UNUSED) {
+	const struct text_key *x = &hash_entry (a, struct text_page, elem)->key;
+	const struct text_key *y = &hash_entry (b, struct text_page, elem)->key;
+
+	if (x->inode != y->inode)
+		return x->inode < y->inode;
+	if (x->generation != y->generation)
+		return x->generation < y->generation;
+	if (x->ofs != y->ofs)
+		return x->ofs < y->ofs;
+	return x->read_bytes < y->read_bytes;
+}
@@ -1,13 +1,17 @@
 /* vm.c: Generic interface for virtual memory objects. */
 
 #include "vm/vm.h"
+#include <string.h>
 #include "threads/malloc.h"
 #include "threads/mmu.h"
 #include "userprog/process.h"
 #include "vm/inspect.h"
+#include "vm/ksm.h"
+#include "vm/textcache.h"
 
 struct list frame_table;
 struct list_elem *start;
+struct lock frame_lock;
 /* Initializes the virtual memory subsystem by invoking each subsystem's
  * intialize codes. */
 void
@@ -21,7 +25,10 @@ vm_init (void) {
 	/* DO NOT MODIFY UPPER LINES. */
 	/* TODO: Your code goes here. */
     list_init(&frame_table);
+	lock_init(&frame_lock);
 	start = list_begin(&frame_table);
+	text_cache_init();
+	ksm_init();
 }
 
 /* Get the type of the page. This function is useful if you want to know the
@@ -41,6 +48,7 @@ page_get_type (struct page *page) {
 /* Helpers */
 static struct frame *vm_get_victim (void);
 static bool vm_do_claim_page (struct page *page);
+static bool vm_map_shared_text (struct page *page, struct frame *frame);
 static struct frame *vm_evict_frame (void);
 
 /* Create the pending page object with initializer. If you want to create a
@@ -79,6 +87,7 @@ vm_alloc_page_with_initializer (enum vm_type type, void *upage, bool writable,vm
         uninit_new(p, upage, init, type, aux, initializer);
 		
         p->writable = writable;
+        p->owner = thread_current();
 		
 		/* TODO: Insert the page into the spt. */
         return spt_insert_page(spt, p);
@@ -87,29 +96,17 @@ err:
 	return false;
 }
 
-/* Find VA from spt and return page. On error, return NULL. */
+/* Find VA from spt and return page. On error, return NULL.
+ * The lookup key lives on the stack: this runs for every page of every
+ * syscall buffer, and must not allocate. */
 struct page *
 spt_find_page (struct supplemental_page_table *spt UNUSED, void *va UNUSED) {
-	/*
-	struct page *dummy_page = (struct page *)malloc(sizeof(struct page));
-	struct hash_elem *dummy_elem;
-	dummy_page->va = pg_round_down(va);
-	dummy_elem = hash_find(&spt->spt_hash, &dummy_page->hash_elem);
-	
-	free(dummy_page);
-	
-	if(!dummy_elem)
-		return NULL; 
-
-	return hash_entry(dummy_elem, struct page, hash_elem);
-	*/
-    struct page* page = (struct page*)malloc(sizeof(struct page)); // dummy page 생성
+    struct page page;
     struct hash_elem *e;
 
-    page->va = pg_round_down(va); 
-    e = hash_find(&spt->spt_hash, &page->hash_elem); 
+    page.va = pg_round_down(va); 
+    e = hash_find(&spt->spt_hash, &page.hash_elem); 
 
-    free(page);
     return e != NULL ? hash_entry(e,struct page,hash_elem) : NULL;
 }
 
@@ -143,16 +140,24 @@ spt_remove_page (struct supplemental_page_table *spt, struct page *page) {
 	return true;
 }
 
-/* Get the struct frame, that will be evicted. */
+/* Get the struct frame, that will be evicted.
+ * Frames mapped by more than one page (merged by ksm.c or shared through
+ * the text cache) are never chosen: evicting one would only unmap one of
+ * its sharers.  Returns a null pointer if every frame is shared. */
 static struct frame *
 vm_get_victim (void) {
 	struct frame *victim = NULL;
+	struct frame *fallback = NULL;
 	 /* TODO: The policy for eviction is up to you. */
 	struct thread *current_thread = thread_current();
 	struct list_elem *search_elem = start;
 	
 	for (start = search_elem; start != list_end(&frame_table); start = list_next(start)) {
 		victim = list_entry(start, struct frame, frame_elem);
+		if (victim->ref_cnt > 1 || victim->loading)
+			continue;
+		if (fallback == NULL)
+			fallback = victim;
 		
 		if (pml4_is_accessed(current_thread->pml4, victim->page->va)) {
 			pml4_set_accessed(current_thread->pml4, victim->page->va, 0);
@@ -163,6 +168,10 @@ vm_get_victim (void) {
 	
 	for (start = list_begin(&frame_table); start != search_elem; start = list_next(start)) {
 		victim = list_entry(start, struct frame, frame_elem);
+		if (victim->ref_cnt > 1 || victim->loading)
+			continue;
+		if (fallback == NULL)
+			fallback = victim;
 		
 		if (pml4_is_accessed(current_thread->pml4, victim->page->va)) {
 			pml4_set_accessed(current_thread->pml4, victim->page->va, 0);
@@ -171,7 +180,9 @@ vm_get_victim (void) {
 		}
 	}
 	
-	return victim;
+	/* Every unshared frame was recently accessed: take the first one.
+	 * Frames still being loaded are never taken. */
+	return fallback;
 }
 
 /* Evict one page and return the corresponding frame.
@@ -180,26 +191,48 @@ static struct frame *
 vm_evict_frame (void) {
 	struct frame *victim = vm_get_victim ();
 	/* TODO: swap out the victim and return the evicted frame. */
+	if (victim == NULL)
+		return NULL;
     swap_out(victim->page);
 	return victim;
 }
 
 /* palloc() and get frame. If there is no available page, evict the page
- * and return it. This always return valid address. That is, if the user pool
- * memory is full, this function evicts the frame to get the available memory
- * space.*/
+ * and return it. If the user pool is full and every frame in use is
+ * shared, there is nothing to evict and a null pointer is returned.
+ * The frame is returned marked as loading, so that neither eviction nor
+ * ksmd touches it; the caller clears the mark, with frame_lock held,
+ * once the frame holds its contents. */
 static struct frame *
 vm_get_frame (void) {
 	struct frame *frame = (struct frame *)malloc(sizeof(struct frame));
     /* TODO: Fill this function. */
+    lock_acquire(&frame_lock);
     frame->kva = palloc_get_page(PAL_USER);                    
     if (frame->kva == NULL){
+        free(frame);
         frame = vm_evict_frame();
+		if (frame == NULL) {
+			lock_release(&frame_lock);
+			return NULL;
+		}
+		if (frame->page != NULL)
+			frame->page->frame = NULL;
+		text_cache_remove(frame);
 		frame->page = NULL;
+		frame->ref_cnt = 0;
+		frame->loading = true;
+		list_init(&frame->sharers);
+		lock_release(&frame_lock);
 		return frame;
     }
     list_push_back (&frame_table, &frame->frame_elem);
 	frame->page = NULL;
+	frame->ref_cnt = 0;
+	frame->text = NULL;
+	frame->loading = true;
+	list_init(&frame->sharers);
+    lock_release(&frame_lock);
 
     ASSERT(frame != NULL);
     ASSERT(frame->page == NULL);
@@ -217,9 +250,53 @@ vm_stack_growth (void *addr UNUSED) {
 	return false;
 }
 
-/* Handle the fault on write_protected page */
+/* Handle the fault on write_protected page.
+ * A writable page only ends up write-protected when its frame is shared
+ * (see ksm.c), so give the faulting page a private copy of the frame. */
 static bool
 vm_handle_wp (struct page *page UNUSED) {
+	struct frame *old_frame = page->frame;
+	struct frame *new_frame = NULL;
+	uint64_t *pte;
+
+	if (old_frame == NULL || !page->writable)
+		return false;
+
+	pte = pml4e_walk (page->owner->pml4, (uint64_t) page->va, 0);
+	if (pte == NULL)
+		return false;
+
+	if (old_frame->ref_cnt > 1) {
+		new_frame = vm_get_frame ();
+		if (new_frame == NULL)
+			return false;
+	}
+
+	lock_acquire (&frame_lock);
+	if (old_frame->ref_cnt > 1) {
+		memcpy (new_frame->kva, old_frame->kva, PGSIZE);
+		list_remove (&page->share_elem);
+		old_frame->ref_cnt--;
+		if (old_frame->page == page)
+			old_frame->page = list_entry (list_front (&old_frame->sharers),
+					struct page, share_elem);
+		frame_share (new_frame, page);
+		new_frame->loading = false;
+		ksm_unshared (page);
+		*pte = vtop (new_frame->kva) | PTE_P | PTE_W | PTE_U;
+	} else {
+		/* Last user of the frame, simply give the write permission back. */
+		if (new_frame != NULL) {
+			frame_table_remove (new_frame);
+			palloc_free_page (new_frame->kva);
+			free (new_frame);
+		}
+		*pte |= PTE_W;
+	}
+	lock_release (&frame_lock);
+
+	pml4_invalidate_page (page->owner->pml4, page->va);
+	return true;
 }
 
 /* Return true on success */
@@ -230,6 +307,11 @@ vm_try_handle_fault (struct intr_frame *f UNUSED, void *addr UNUSED, bool user U
     if (addr == NULL)
         return false;
 
+    if (!not_present && write && is_user_vaddr(addr)) {
+        page = spt_find_page(spt, addr);
+        return page != NULL && vm_handle_wp(page);
+    }
+
     if (!addr || is_kernel_vaddr(addr) || !not_present)
 	{
 		return false;
@@ -275,33 +357,62 @@ vm_claim_page (void *va UNUSED) {
     return vm_do_claim_page(page);
 }
 
-/* Claim the PAGE and set up the mmu. */
+/* Claim the PAGE and set up the mmu.
+ * A read-only page of an executable that another process already has
+ * loaded is mapped onto that process's frame instead of being read again
+ * (see textcache.c). */
 static bool
 vm_do_claim_page (struct page *page) {
-	/*
-    if (!page || !is_user_vaddr(page->va)) {
-		return false;
+	struct thread *t = thread_current ();
+	struct frame *frame;
+	struct text_key key;
+	bool text = text_cache_key (page, &key);
+	bool success;
+
+	if (text) {
+		lock_acquire (&frame_lock);
+		frame = text_cache_lookup (&key);
+		if (frame != NULL) {
+			frame_share (frame, page);
+			lock_release (&frame_lock);
+			return vm_map_shared_text (page, frame);
+		}
+		lock_release (&frame_lock);
 	}
-    struct frame *frame = vm_get_frame ();
-    frame->page = page;
-    page->frame = frame;
 
-   	if(!pml4_set_page(thread_current()->pml4, page->va, frame->kva, page->writable)) {
+	frame = vm_get_frame ();
+	if (frame == NULL)
 		return false;
-	}
-	return swap_in(page, frame->kva);
-	*/
-	struct thread *t = thread_current ();
-    struct frame *frame = vm_get_frame ();
 
-    /* Set links */
-    frame->page = page;
-    page->frame = frame;
+	/* Set links */
+	lock_acquire (&frame_lock);
+	frame_share (frame, page);
+	lock_release (&frame_lock);
+
+	success = pml4_get_page (t->pml4, page->va) == NULL
+		&& pml4_set_page (t->pml4, page->va, frame->kva, page->writable)
+		&& swap_in (page, frame->kva);
+
+	/* Only now may the frame be evicted or merged. */
+	lock_acquire (&frame_lock);
+	if (success && text)
+		text_cache_insert (frame, &key);
+	frame->loading = false;
+	lock_release (&frame_lock);
+	return success;
+}
 
-    if(pml4_get_page (t->pml4, page->va) == NULL&& pml4_set_page (t->pml4, page->va, frame->kva, page->writable)){
-        return swap_in(page, frame->kva);
-    }
-    return false;
+/* Maps PAGE, which has already taken a reference on the cached text
+ * FRAME, read-only.  The page is turned into its final type without
+ * reading anything, since FRAME already holds its contents. */
+static bool
+vm_map_shared_text (struct page *page, struct frame *frame) {
+	struct uninit_page *uninit = &page->uninit;
+
+	if (!uninit->page_initializer (page, uninit->type, frame->kva))
+		return false;
+	return pml4_get_page (thread_current ()->pml4, page->va) == NULL
+		&& pml4_set_page (thread_current ()->pml4, page->va, frame->kva, false);
 }
 
 /* Initialize new supplemental page table */
@@ -357,7 +468,9 @@ supplemental_page_table_copy (struct supplemental_page_table *dst UNUSED, struct
                 return false;
             struct page *file_page = spt_find_page(dst, upage);
             file_backed_initializer(file_page, type, NULL);
-            file_page->frame = src_page->frame;
+            lock_acquire(&frame_lock);
+            frame_share(src_page->frame, file_page);
+            lock_release(&frame_lock);
             pml4_set_page(thread_current()->pml4, file_page->va, src_page->frame->kva, src_page->writable);
             continue;
         }
@@ -365,11 +478,25 @@ supplemental_page_table_copy (struct supplemental_page_table *dst UNUSED, struct
         if (!vm_alloc_page(type, upage, writable))
             return false;
 
+        /* Executable text stays shared with the parent. */
+        if (src_page->frame != NULL && src_page->frame->text != NULL) {
+            struct page *text_page = spt_find_page(dst, upage);
+            lock_acquire(&frame_lock);
+            frame_share(src_page->frame, text_page);
+            lock_release(&frame_lock);
+            if (!vm_map_shared_text(text_page, src_page->frame))
+                return false;
+            continue;
+        }
+
         if (!vm_claim_page(upage))
             return false;
 
+        /* Keep ksmd from merging either frame during the copy. */
         struct page *dst_page = spt_find_page(dst, upage);
+        lock_acquire(&frame_lock);
         memcpy(dst_page->frame->kva, src_page->frame->kva, PGSIZE);
+        lock_release(&frame_lock);
     }
 
     return true;
@@ -389,6 +516,8 @@ supplemental_page_table_kill (struct supplemental_page_table *spt UNUSED) {
         if (page->operations->type == VM_FILE) {
             do_munmap(page->va);
         }
+        if (page->frame != NULL)
+            frame_release(page);
     }
 	//hash_clear(&spt->spt_hash, spt_destructor);
 }
@@ -397,4 +526,55 @@ void spt_destructor(struct hash_elem *e, void *aux)
 {
     struct page *page = hash_entry(e, struct page, hash_elem);
     vm_dealloc_page(page);
-}
\ No newline at end of file
+}
+
+/* Adds PAGE to the pages mapping FRAME.  The first page becomes the
+ * frame's primary page, which is the one swapped out on eviction.
+ * Must be called with frame_lock held. */
+void
+frame_share (struct frame *frame, struct page *page) {
+	ASSERT (lock_held_by_current_thread (&frame_lock));
+
+	if (frame->ref_cnt++ == 0)
+		frame->page = page;
+	list_push_back (&frame->sharers, &page->share_elem);
+	page->frame = frame;
+}
+
+/* Drops PAGE's reference to its frame, on process teardown.
+ * While other pages still map the frame, PAGE's mapping is cleared so that
+ * pml4_destroy() does not free the shared kva under them.  The last
+ * reference removes the frame from the frame table; its kva is freed
+ * together with the page table. */
+void
+frame_release (struct page *page) {
+	struct frame *frame = page->frame;
+
+	lock_acquire (&frame_lock);
+	if (frame->ref_cnt > 1) {
+		pml4_clear_page (page->owner->pml4, page->va);
+		list_remove (&page->share_elem);
+		frame->ref_cnt--;
+		if (frame->page == page)
+			frame->page = list_entry (list_front (&frame->sharers),
+					struct page, share_elem);
+		ksm_unshared (page);
+	} else {
+		text_cache_remove (frame);
+		frame_table_remove (frame);
+		free (frame);
+	}
+	page->frame = NULL;
+	lock_release (&frame_lock);
+}
+
+/* Removes FRAME from the frame table, keeping the clock hand valid.
+ * Must be called with frame_lock held. */
+void
+frame_table_remove (struct frame *frame) {
+	ASSERT (lock_held_by_current_thread (&frame_lock));
+
+	if (start == &frame->frame_elem)
+		start = list_next (start);
+	list_remove (&frame->frame_elem);
+}
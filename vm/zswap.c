@@ -0,0 +1,300 @@
+/* zswap.c: Compressed cache in front of the swap disk.
+ *
+ * Evicted anonymous pages are compressed into a pool of kernel pages
+ * carved out with palloc.  A later fault on such a page only costs a
+ * decompression instead of a round trip to the swap disk.  When the pool
+ * runs out of room, the least recently stored pages are written back to
+ * the swap disk to make space. */
+
+#include "vm/zswap.h"
+#include <bitmap.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+
+/* Compressed stream format.
+ * A control byte C below 0x80 is followed by C + 1 literal bytes.
+ * Otherwise it describes a match of (C & 0x7f) + LZ_MIN_MATCH bytes,
+ * followed by a 16-bit little-endian backward offset. */
+#define LZ_MIN_MATCH 4
+#define LZ_MAX_MATCH (0x7f + LZ_MIN_MATCH)
+#define LZ_MAX_LITERAL 0x80
+#define LZ_HASH_BITS 10
+
+static uint8_t *pool;               /* Base of the compressed pool. */
+static struct bitmap *pool_map;     /* Used slots of the pool. */
+static uint8_t *scratch;            /* Compression output buffer. */
+static struct list lru_list;        /* Entries, least recently stored first. */
+static struct lock zswap_lock;
+
+static uint16_t lz_table[1 << LZ_HASH_BITS];
+
+/* Statistics. */
+static long long stored_cnt;        /* # of pages compressed into the pool. */
+static long long loaded_cnt;        /* # of pages decompressed from it. */
+static long long rejected_cnt;      /* # of pages that did not compress. */
+static long long writeback_cnt;     /* # of pages written back to disk. */
+
+static size_t lz_compress (const uint8_t *src, uint8_t *dst, size_t dst_len);
+static bool lz_decompress (const uint8_t *src, size_t src_len, uint8_t *dst);
+static size_t zswap_alloc (size_t slot_cnt);
+static bool zswap_writeback (void);
+static void zswap_free (struct zswap_entry *entry);
+
+#define slots_of(LEN) (((LEN) + ZSWAP_SLOT_SIZE - 1) / ZSWAP_SLOT_SIZE)
+
+/* Carves the pool out of the kernel pool.  If memory is short the cache
+ * is simply disabled and every page goes to the swap disk. */
+void
+zswap_init (void) {
+	list_init (&lru_list);
+	lock_init (&zswap_lock);
+
+	scratch = palloc_get_page (0);
+	pool = palloc_get_multiple (0, ZSWAP_POOL_PAGES);
+	pool_map = bitmap_create (ZSWAP_POOL_PAGES * PGSIZE / ZSWAP_SLOT_SIZE);
+	if (scratch == NULL || pool == NULL || pool_map == NULL) {
+		palloc_free_page (scratch);
+		palloc_free_multiple (pool, ZSWAP_POOL_PAGES);
+		if (pool_map != NULL)
+			bitmap_destroy (pool_map);
+		pool = NULL;
+	}
+}
+
+/* Compresses the contents of PAGE, found at KVA, into the pool.
+ * Returns false if the page should go to the swap disk instead. */
+bool
+zswap_store (struct page *page, const void *kva) {
+	struct zswap_entry *entry;
+	size_t len, slot;
+
+	if (pool == NULL)
+		return false;
+
+	lock_acquire (&zswap_lock);
+	len = lz_compress (kva, scratch, ZSWAP_MAX_LEN);
+	if (len == 0) {
+		rejected_cnt++;
+		lock_release (&zswap_lock);
+		return false;
+	}
+
+	entry = malloc (sizeof *entry);
+	if (entry == NULL) {
+		lock_release (&zswap_lock);
+		return false;
+	}
+
+	while ((slot = zswap_alloc (slots_of (len))) == BITMAP_ERROR)
+		if (!zswap_writeback ()) {
+			free (entry);
+			lock_release (&zswap_lock);
+			return false;
+		}
+
+	memcpy (pool + slot * ZSWAP_SLOT_SIZE, scratch, len);
+	entry->page = page;
+	entry->slot = slot;
+	entry->len = len;
+	list_push_back (&lru_list, &entry->lru_elem);
+	page->anon.zswap = entry;
+	stored_cnt++;
+	lock_release (&zswap_lock);
+	return true;
+}
+
+/* Decompresses PAGE into KVA and drops it from the pool. */
+bool
+zswap_load (struct page *page, void *kva) {
+	struct zswap_entry *entry;
+	bool success;
+
+	lock_acquire (&zswap_lock);
+	entry = page->anon.zswap;
+	if (entry == NULL) {
+		/* Written back while we waited for the lock. */
+		lock_release (&zswap_lock);
+		if (page->anon.swap_index < 0
+				|| !swap_slot_read (page->anon.swap_index, kva))
+			return false;
+		page->anon.swap_index = -1;
+		return true;
+	}
+
+	success = lz_decompress (pool + entry->slot * ZSWAP_SLOT_SIZE,
+			entry->len, kva);
+	zswap_free (entry);
+	page->anon.zswap = NULL;
+	loaded_cnt++;
+	lock_release (&zswap_lock);
+	return success;
+}
+
+/* Drops the compressed copy of PAGE, whose owner no longer needs it. */
+void
+zswap_invalidate (struct page *page) {
+	lock_acquire (&zswap_lock);
+	if (page->anon.zswap != NULL) {
+		zswap_free (page->anon.zswap);
+		page->anon.zswap = NULL;
+	}
+	lock_release (&zswap_lock);
+}
+
+/* Prints swap cache statistics. */
+void
+zswap_print_stats (void) {
+	printf ("Zswap: %lld stored, %lld loaded, %lld rejected, "
+			"%lld written back\n",
+			stored_cnt, loaded_cnt, rejected_cnt, writeback_cnt);
+}
+
+/* Returns the first of SLOT_CNT free contiguous slots, marking them
+ * used, or BITMAP_ERROR. */
+static size_t
+zswap_alloc (size_t slot_cnt) {
+	return bitmap_scan_and_flip (pool_map, 0, slot_cnt, false);
+}
+
+/* Moves the least recently stored page to the swap disk.
+ * Returns false if there is nothing left to write back or the disk is
+ * full.  The scratch page still holds the output of the store in
+ * progress, so the page is expanded into a bounce page. */
+static bool
+zswap_writeback (void) {
+	struct zswap_entry *entry;
+	struct page *page;
+	void *bounce;
+	int page_no;
+
+	if (list_empty (&lru_list))
+		return false;
+
+	bounce = palloc_get_page (0);
+	if (bounce == NULL)
+		return false;
+
+	entry = list_entry (list_front (&lru_list), struct zswap_entry, lru_elem);
+	page = entry->page;
+	if (!lz_decompress (pool + entry->slot * ZSWAP_SLOT_SIZE, entry->len,
+				bounce)
+			|| (page_no = swap_slot_write (bounce)) < 0) {
+		palloc_free_page (bounce);
+		return false;
+	}
+
+	page->anon.swap_index = page_no;
+	page->anon.zswap = NULL;
+	zswap_free (entry);
+	palloc_free_page (bounce);
+	writeback_cnt++;
+	return true;
+}
+
+/* Releases ENTRY's slots and ENTRY itself. */
+static void
+zswap_free (struct zswap_entry *entry) {
+	bitmap_set_multiple (pool_map, entry->slot, slots_of (entry->len), false);
+	list_remove (&entry->lru_elem);
+	free (entry);
+}
+
+/* Hashes the 4 bytes at P into lz_table. */
+static inline size_t
+lz_hash (const uint8_t *p) {
+	uint32_t v = p[0] | p[1] << 8 | p[2] << 16 | (uint32_t) p[3] << 24;
+	return (v * 2654435761u) >> (32 - LZ_HASH_BITS);
+}
+
+/* Flushes the pending literals [LIT, END) into DST.
+ * Returns the new output length, or 0 if DST_LEN would be exceeded. */
+static size_t
+lz_literals (const uint8_t *lit, const uint8_t *end, uint8_t *dst,
+		size_t out, size_t dst_len) {
+	while (lit < end) {
+		size_t run = end - lit < LZ_MAX_LITERAL ? end - lit : LZ_MAX_LITERAL;
+		if (out + 1 + run > dst_len)
+			return 0;
+		dst[out++] = run - 1;
+		memcpy (dst + out, lit, run);
+		out += run;
+		lit += run;
+	}
+	return out;
+}
+
+/* Compresses the page at SRC into DST.  Returns the compressed length,
+ * or 0 if it does not fit in DST_LEN bytes. */
+static size_t
+lz_compress (const uint8_t *src, uint8_t *dst, size_t dst_len) {
+	const uint8_t *end = src + PGSIZE;
+	const uint8_t *p = src, *lit = src;
+	size_t out = 0;
+
+	memset (lz_table, 0, sizeof lz_table);
+	while (p + LZ_MIN_MATCH <= end) {
+		size_t h = lz_hash (p);
+		const uint8_t *ref = src + lz_table[h];
+		size_t len = 0;
+
+		lz_table[h] = p - src;
+		if (ref < p && memcmp (ref, p, LZ_MIN_MATCH) == 0) {
+			len = LZ_MIN_MATCH;
+			while (p + len < end && len < LZ_MAX_MATCH && ref[len] == p[len])
+				len++;
+		}
+		if (len == 0) {
+			p++;
+			continue;
+		}
+
+		if (lit < p && (out = lz_literals (lit, p, dst, out, dst_len)) == 0)
+			return 0;
+		if (out + 3 > dst_len)
+			return 0;
+		dst[out++] = 0x80 | (len - LZ_MIN_MATCH);
+		dst[out++] = (p - ref) & 0xff;
+		dst[out++] = (p - ref) >> 8;
+		p += len;
+		lit = p;
+	}
+	if (lit < end && (out = lz_literals (lit, end, dst, out, dst_len)) == 0)
+		return 0;
+	return out;
+}
+
+/* Expands SRC_LEN bytes at SRC into the page at DST.
+ * Returns false if the stream is corrupted. */
+static bool
+lz_decompress (const uint8_t *src, size_t src_len, uint8_t *dst) {
+	const uint8_t *end = src + src_len;
+	size_t out = 0;
+
+	while (src < end) {
+		uint8_t c = *src++;
+		if (c < 0x80) {
+			size_t run = c + 1;
+			if (src + run > end || out + run > PGSIZE)
+				return false;
+			memcpy (dst + out, src, run);
+			src += run;
+			out += run;
+		} else {
+			size_t len = (c & 0x7f) + LZ_MIN_MATCH;
+			size_t ofs;
+			if (src + 2 > end)
+				return false;
+			ofs = src[0] | src[1] << 8;
+			src += 2;
+			if (ofs == 0 || ofs > out || out + len > PGSIZE)
+				return false;
+			/* Byte by byte: the match may overlap its own output. */
+			for (size_t i = 0; i < len; i++, out++)
+				dst[out] = dst[out - ofs];
+		}
+	}
+	return out == PGSIZE;
+}